@@ -0,0 +1,56 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+in vec3 Tangent;
+
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+uniform vec3 objectColor;
+uniform bool useTexture;
+uniform sampler2D clothTexture;
+
+void main()
+{
+    // -------------------------------------------
+    // Silk Rendering - Anisotropic Specular
+    // -------------------------------------------
+    
+    vec3 N = normalize(Normal);
+    vec3 T = normalize(Tangent);
+    vec3 V = normalize(viewPos - FragPos);
+    vec3 L = normalize(lightPos - FragPos);
+    
+    // Calculate reflection vector R = reflect(-L, N)
+    vec3 R = reflect(-L, N);
+    
+    // Half-way vector H
+    vec3 H = normalize(L + V);
+
+    // 1. Ambient
+    float ambientStrength = 0.2;
+    vec3 ambient = ambientStrength * vec3(1.0);
+  
+    // 2. Diffuse
+    float diff = max(dot(N, L), 0.0);
+    vec3 diffuse = diff * vec3(1.0) * 0.8;
+    
+    // 3. Anisotropic Specular
+    // We use the half-way vector H projected onto the tangent plane as the specular direction
+    // For simpler calculation, use the sin(theta_TH) approach which gives better silk sheen
+    float dotTH = dot(T, H);
+    // sin(theta) = sqrt(1 - cos^2(theta)), where cos(theta)=dot(T, H)
+    float sinTH = sqrt(1.0 - dotTH * dotTH);
+    // Higher power for sharper specular highlight
+    float spec = pow(max(sinTH, 0.0), 80.0); 
+    
+    vec3 specularColor = vec3(1.0, 0.95, 0.9);
+    vec3 specular = 1.5 * spec * specularColor;
+
+    vec3 baseColor = objectColor;
+    
+    vec3 result = (ambient + diffuse) * baseColor + specular;
+    FragColor = vec4(result, 1.0);
+}
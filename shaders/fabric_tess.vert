@@ -0,0 +1,15 @@
+#version 400 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 4) in vec2 aCompression;
+
+out vec3 vPos;
+out vec2 vTexCoords;
+out vec2 vCompression;
+
+void main()
+{
+    vPos = aPos;
+    vTexCoords = aTexCoords;
+    vCompression = aCompression;
+}
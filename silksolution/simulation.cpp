@@ -10,8 +10,27 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 #include <algorithm> //  std::clamp
 
+#include "src/Cloth.h"
+#include "src/AdaptiveStepper.h"
+#include "src/BatchRunner.h"
+#include "src/ClothCompute.h"
+#include "src/ClothDetail.h"
+#include "src/ClothLOD.h"
+#include "src/ClothScene.h"
+#include "src/FrameCapture.h"
+#include "src/FrameMemory.h"
+#include "src/HeadlessContext.h"
+#include "src/KernelBench.h"
+#include "src/ObjImport.h"
+#include "src/MeshOrder.h"
+#include "src/ShaderManager.h"
+
 // ==========================================
 // 볣
 // ==========================================
@@ -21,21 +40,55 @@ const unsigned int SCR_HEIGHT = 720;
 // Cloth resolution
 const int CLOTH_W = 60;
 const int CLOTH_H = 60;
-const float DAMPING = 0.98f;
 const float TIME_STEP = 0.01f;
-const int CONSTRAINT_ITERATIONS = 5;
-
-// Silk physical parameters
-const float STRUCTURAL_STIFFNESS = 1.0f;
-const float SHEAR_STIFFNESS = 0.8f;
-const float BENDING_STIFFNESS = 0.05f;
 
 // Render mode state
-enum RenderMode { SHADED, WIREFRAME, POINTS };
 RenderMode currentRenderMode = SHADED;
 bool key_M_pressed = false;
 float pointSize = 3.0f;
 
+// Surface detail state (T key): smooth surface + wrinkles over the coarse grid
+enum DetailMode { DETAIL_OFF, DETAIL_GPU, DETAIL_CPU };
+DetailMode detailMode = DETAIL_OFF;
+bool key_T_pressed = false;
+
+// Level of detail state (L key): coarser grids when the cloth is small on screen
+bool lodEnabled = true;
+bool key_L_pressed = false;
+
+// Constraint solver (G key): Gauss-Seidel sweeps, multigrid V-cycles or,
+// with GL 4.3, the whole step in compute shaders
+SolverMode solverMode = SOLVER_GAUSS_SEIDEL;
+bool computeAvailable = false;
+bool key_G_pressed = false;
+
+// Tearing (R key): the grabbed particle rips the cloth when pulled too far
+bool tearingEnabled = false;
+bool key_R_pressed = false;
+
+// Time stepping (P key): adaptive substeps (see src/AdaptiveStepper.h), or
+// the fixed 0.01 s step, which the multigrid and compute solvers always use
+bool adaptiveStepping = true;
+bool key_P_pressed = false;
+
+// Scene setup (--panels N, --threads N, --obj FILE)
+int scenePanels = 1;
+int poolThreads = 0;
+std::string garmentPath;
+
+// Allocation check (--alloc-check N): count heap allocations per frame
+// phase after N warm-up frames (see src/FrameMemory.h)
+int allocWarmupFrames = 0;
+
+const char* solverName(SolverMode mode)
+{
+    switch (mode) {
+    case SOLVER_MULTIGRID: return "Multigrid";
+    case SOLVER_COMPUTE:   return "Compute Shader";
+    default:               return "Gauss-Seidel";
+    }
+}
+
 // ==========================================
 // Global Camera and Mouse State
 // ==========================================
@@ -61,341 +114,18 @@ float grabDistance = 0.0f;
 bool isDraggingCamera = false;
 
 // ==========================================
-// Shader Source (Anisotropic Lighting)
+// Shader Uniforms (Anisotropic Lighting)
 // ==========================================
-const char* vertexShaderSource = R"(
-#version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-
-out vec3 FragPos;
-out vec3 Normal;
-out vec2 TexCoords;
-out vec3 Tangent;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    Tangent = mat3(model) * aTangent; 
-    TexCoords = aTexCoords;
-    
-    gl_Position = projection * view * vec4(FragPos, 1.0);
-}
-)";
-
-const char* fragmentShaderSource = R"(
-#version 330 core
-out vec4 FragColor;
-
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
-in vec3 Tangent;
-
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 objectColor;
-uniform bool useTexture;
-uniform sampler2D clothTexture;
-
-void main()
-{
-    // -------------------------------------------
-    // Silk Rendering - Anisotropic Specular
-    // -------------------------------------------
-    
-    vec3 N = normalize(Normal);
-    vec3 T = normalize(Tangent);
-    vec3 V = normalize(viewPos - FragPos);
-    vec3 L = normalize(lightPos - FragPos);
-    
-    // Calculate reflection vector R = reflect(-L, N)
-    vec3 R = reflect(-L, N);
-    
-    // Half-way vector H
-    vec3 H = normalize(L + V);
-
-    // 1. Ambient
-    float ambientStrength = 0.2;
-    vec3 ambient = ambientStrength * vec3(1.0);
-  
-    // 2. Diffuse
-    float diff = max(dot(N, L), 0.0);
-    vec3 diffuse = diff * vec3(1.0) * 0.8;
-    
-    // 3. Anisotropic Specular
-    // We use the half-way vector H projected onto the tangent plane as the specular direction
-    // For simpler calculation, use the sin(theta_TH) approach which gives better silk sheen
-    float dotTH = dot(T, H);
-    // sin(theta) = sqrt(1 - cos^2(theta)), where cos(theta)=dot(T, H)
-    float sinTH = sqrt(1.0 - dotTH * dotTH);
-    // Higher power for sharper specular highlight
-    float spec = pow(max(sinTH, 0.0), 80.0); 
-    
-    vec3 specularColor = vec3(1.0, 0.95, 0.9);
-    vec3 specular = 1.5 * spec * specularColor;
-
-    vec3 baseColor = objectColor;
-    
-    vec3 result = (ambient + diffuse) * baseColor + specular;
-    FragColor = vec4(result, 1.0);
-}
-)";
-
-// ==========================================
-// Physics Structure
-// ==========================================
-struct Particle {
-    glm::vec3 position;
-    glm::vec3 oldPosition;
-    glm::vec3 acceleration;
-    glm::vec2 uv;
-    glm::vec3 normal;
-    glm::vec3 tangent;
-    bool isPinned;
-    float mass;
-
-    Particle(glm::vec3 pos, glm::vec2 tex) :
-        position(pos), oldPosition(pos), acceleration(0.0f),
-        uv(tex), normal(0.0f, 0.0f, 1.0f), tangent(1.0f, 0.0f, 0.0f),
-        isPinned(false), mass(1.0f) {
-    }
-
-    void addForce(glm::vec3 f) {
-        acceleration += f / mass;
-    }
-
-    void update(float dt) {
-        if (isPinned) return;
-
-        glm::vec3 velocity = position - oldPosition;
-        oldPosition = position;
-        // ʹ std::clamp ٶȣֹӷߣȶ
-        float velocityMag = glm::length(velocity);
-        if (velocityMag > 10.0f) { // ٶ
-            velocity = glm::normalize(velocity) * 10.0f;
-        }
-
-        position += velocity * DAMPING + acceleration * dt * dt;
-        acceleration = glm::vec3(0.0f);
-    }
+// Program sources live in shaders/fabric.vert and shaders/fabric.frag; the
+// tessellated variant adds fabric_tess.vert/.tesc/.tese. Both programs share
+// one table. Order must match FABRIC_UNIFORM_NAMES.
+enum FabricUniform {
+    U_PROJECTION, U_VIEW, U_MODEL, U_VIEW_POS, U_LIGHT_POS, U_OBJECT_COLOR, U_USE_TEXTURE,
+    U_TESS_LEVEL, U_GRID_CELLS, U_WRINKLE_AMPLITUDE, U_WRINKLE_FREQUENCY
 };
-
-struct Constraint {
-    Particle* p1;
-    Particle* p2;
-    float restDistance;
-    float stiffness;
-
-    Constraint(Particle* pi, Particle* pj, float stiff) : p1(pi), p2(pj), stiffness(stiff) {
-        restDistance = glm::distance(p1->position, p2->position);
-    }
-
-    void solve() {
-        glm::vec3 delta = p2->position - p1->position;
-        float currentDist = glm::length(delta);
-        if (currentDist == 0.0f) return;
-
-        // PBD Լ
-        float correctionAmount = (currentDist - restDistance) / currentDist;
-        glm::vec3 correction = delta * correctionAmount * 0.5f * stiffness;
-
-        if (!p1->isPinned) p1->position += correction;
-        if (!p2->isPinned) p2->position -= correction;
-    }
-};
-
-// ==========================================
-// Cloth Class
-// ==========================================
-class Cloth {
-public:
-    int width, height;
-    std::vector<Particle> particles;
-    std::vector<Constraint> constraints;
-    std::vector<unsigned int> indices;
-
-    unsigned int VAO, VBO, EBO;
-
-    Cloth(int w, int h) : width(w), height(h) {
-        particles.reserve(w * h);
-        float spacing = 0.1f;
-
-        // ʼ񣬲΢̧ߣʹ䴦Ұ
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                // ʼλ Y=3.0f 
-                glm::vec3 pos((x - w / 2.0f) * spacing, 3.0f + (y - h / 2.0f) * spacing, 0.0f);
-                glm::vec2 uv((float)x / (w - 1), (float)y / (h - 1));
-                Particle p(pos, uv);
-
-                // סԵӣÿ5̶һ
-                if (y == h - 1 && (x % 5 == 0)) {
-                    p.isPinned = true;
-                }
-                particles.push_back(p);
-            }
-        }
-
-        auto addConstraint = [&](int x1, int y1, int x2, int y2, float k) {
-            if (x1 >= 0 && x1 < w && y1 >= 0 && y1 < h &&
-                x2 >= 0 && x2 < w && y2 >= 0 && y2 < h) {
-                constraints.emplace_back(&particles[y1 * w + x1], &particles[y2 * w + x2], k);
-            }
-            };
-
-        // Լ
-        for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                // Structural (ṹԼ)
-                addConstraint(x, y, x + 1, y, STRUCTURAL_STIFFNESS);
-                addConstraint(x, y, x, y + 1, STRUCTURAL_STIFFNESS);
-
-                // Shear (Լ)
-                addConstraint(x, y, x + 1, y + 1, SHEAR_STIFFNESS);
-                addConstraint(x, y, x - 1, y + 1, SHEAR_STIFFNESS);
-
-                // Bending (Լ) - ֲ״
-                addConstraint(x, y, x + 2, y, BENDING_STIFFNESS);
-                addConstraint(x, y, x, y + 2, BENDING_STIFFNESS);
-            }
-        }
-
-        // 
-        for (int y = 0; y < h - 1; y++) {
-            for (int x = 0; x < w - 1; x++) {
-                int topLeft = y * w + x;
-                int topRight = topLeft + 1;
-                int bottomLeft = (y + 1) * w + x;
-                int bottomRight = bottomLeft + 1;
-
-                // Triangle 1
-                indices.push_back(topLeft);
-                indices.push_back(bottomLeft);
-                indices.push_back(topRight);
-
-                // Triangle 2
-                indices.push_back(topRight);
-                indices.push_back(bottomLeft);
-                indices.push_back(bottomRight);
-            }
-        }
-
-        setupMesh();
-    }
-
-    void update(float dt, glm::vec3 wind) {
-        // A. Apply forces (Gravity + Wind)
-        for (auto& p : particles) {
-            if (!p.isPinned) {
-                p.addForce(glm::vec3(0.0f, -9.8f, 0.0f)); // 
-            }
-
-            // 
-            glm::vec3 windForce = wind * (glm::dot(p.normal, glm::normalize(wind)) * 0.8f + 0.2f);
-            p.addForce(windForce);
-        }
-
-        // B. Integrate positions
-        for (auto& p : particles) {
-            p.update(dt);
-        }
-
-        // C. Satisfy constraints (PBD)
-        for (int i = 0; i < CONSTRAINT_ITERATIONS; i++) {
-            for (auto& c : constraints) {
-                c.solve();
-            }
-        }
-
-        // D. Recalculate Normals and Tangents
-        recalculateNormals();
-    }
-
-    void recalculateNormals() {
-        for (auto& p : particles) {
-            p.normal = glm::vec3(0.0f);
-            p.tangent = glm::vec3(0.0f);
-        }
-
-        for (size_t i = 0; i < indices.size(); i += 3) {
-            Particle& p1 = particles[indices[i]];
-            Particle& p2 = particles[indices[i + 1]];
-            Particle& p3 = particles[indices[i + 2]];
-
-            glm::vec3 edge1 = p2.position - p1.position;
-            glm::vec3 edge2 = p3.position - p1.position;
-            glm::vec3 normal = glm::cross(edge1, edge2);
-
-            glm::vec3 tangent = glm::normalize(edge1); // ʹñ1Ϊ
-
-            p1.normal += normal; p2.normal += normal; p3.normal += normal;
-            p1.tangent += tangent; p2.tangent += tangent; p3.tangent += tangent;
-        }
-
-        for (auto& p : particles) {
-            p.normal = glm::normalize(p.normal);
-            p.tangent = glm::normalize(p.tangent);
-        }
-    }
-
-    void setupMesh() {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // Each vertex: Pos(3) + Norm(3) + Tex(2) + Tan(3) = 11 floats
-        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(particles.size() * 11 * sizeof(float)), NULL, GL_DYNAMIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), GL_STATIC_DRAW);
-
-        size_t stride = 11 * sizeof(float);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(8 * sizeof(float)));
-
-        glBindVertexArray(0);
-    }
-
-    void draw(unsigned int shaderProgram, RenderMode mode) {
-        // Update VBO data
-        std::vector<float> data;
-        data.reserve(particles.size() * 11);
-        for (const auto& p : particles) {
-            data.push_back(p.position.x); data.push_back(p.position.y); data.push_back(p.position.z);
-            data.push_back(p.normal.x);   data.push_back(p.normal.y);   data.push_back(p.normal.z);
-            data.push_back(p.uv.x);       data.push_back(p.uv.y);
-            data.push_back(p.tangent.x);  data.push_back(p.tangent.y);  data.push_back(p.tangent.z);
-        }
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(data.size() * sizeof(float)), data.data());
-
-        // Draw based on mode
-        if (mode == POINTS) {
-            glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(particles.size()));
-        }
-        else {
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-        }
-        glBindVertexArray(0);
-    }
+const std::vector<const char*> FABRIC_UNIFORM_NAMES = {
+    "projection", "view", "model", "viewPos", "lightPos", "objectColor", "useTexture",
+    "tessLevel", "gridCells", "wrinkleAmplitude", "wrinkleFrequency"
 };
 
 // ==========================================
@@ -404,16 +134,17 @@ public:
 
 // State struct to pass data to static callbacks
 struct AppState {
-    Cloth* cloth;
-    glm::mat4 projection;
-    glm::mat4 view;
+    ClothScene* scene = nullptr;
+    Cloth* cloth = nullptr; // the panel holding the grabbed particle
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 view = glm::mat4(1.0f);
     // ڳߴ unProject
     int width = SCR_WIDTH;
     int height = SCR_HEIGHT;
 };
 
 // Particle picking function
-int getParticleIndexUnderCursor(double xpos, double ypos, const Cloth& cloth, const glm::mat4& view, const glm::mat4& projection, int width, int height) {
+int getParticleIndexUnderCursor(double xpos, double ypos, const Cloth& cloth, const glm::mat4& view, const glm::mat4& projection, int width, int height, float* distanceSq = nullptr) {
     float closestDistSq = 1000000.0f;
     int closestIndex = -1;
     glm::vec4 viewport = glm::vec4(0, 0, width, height);
@@ -439,27 +170,43 @@ int getParticleIndexUnderCursor(double xpos, double ypos, const Cloth& cloth, co
             closestIndex = i;
         }
     }
+    if (distanceSq) *distanceSq = closestDistSq;
     return closestIndex;
 }
 
 // Mouse button callback (for dragging particles and camera)
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     AppState* state = (AppState*)glfwGetWindowUserPointer(window);
-    Cloth& cloth = *state->cloth;
     double xpos, ypos;
     glfwGetCursorPos(window, &xpos, &ypos);
 
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == GLFW_PRESS) {
             // ʰȡ
-            grabbedParticleIndex = getParticleIndexUnderCursor(xpos, ypos, cloth, state->view, state->projection, state->width, state->height);
+            // Nearest hit over the visible panels
+            grabbedParticleIndex = -1;
+            float bestDistSq = 0.0f;
+            for (int i = 0; i < state->scene->size(); i++) {
+                ClothPanel& panel = state->scene->panel(i);
+                if (!panel.visible) continue;
+                panel.lod->active().fetchFromGpu();
+                float distSq;
+                int index = getParticleIndexUnderCursor(xpos, ypos, panel.lod->active(), state->view, state->projection, state->width, state->height, &distSq);
+                if (index != -1 && (grabbedParticleIndex == -1 || distSq < bestDistSq)) {
+                    grabbedParticleIndex = index;
+                    bestDistSq = distSq;
+                    state->cloth = &panel.lod->active();
+                }
+            }
 
             if (grabbedParticleIndex != -1) {
+                Cloth& cloth = *state->cloth;
                 // ʰȡɹתȷק
                 glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
                 isDraggingCamera = false;
 
                 cloth.particles[grabbedParticleIndex].isPinned = true;
+                cloth.particleChanged(grabbedParticleIndex);
 
                 // ץȡ
                 glm::vec4 p_view = state->view * glm::vec4(cloth.particles[grabbedParticleIndex].position, 1.0f);
@@ -469,7 +216,8 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
         else if (action == GLFW_RELEASE) {
             if (grabbedParticleIndex != -1) {
                 // ͷ
-                cloth.particles[grabbedParticleIndex].isPinned = false;
+                state->cloth->particles[grabbedParticleIndex].isPinned = false;
+                state->cloth->particleChanged(grabbedParticleIndex);
             }
             grabbedParticleIndex = -1;
             grabDistance = 0.0f;
@@ -494,7 +242,6 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 // Mouse position callback (for dragging particles and rotating camera)
 void cursor_position_callback(GLFWwindow* window, double xposIn, double yposIn) {
     AppState* state = (AppState*)glfwGetWindowUserPointer(window);
-    Cloth& cloth = *state->cloth;
 
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
@@ -550,8 +297,10 @@ void cursor_position_callback(GLFWwindow* window, double xposIn, double yposIn)
         glm::vec3 newWorldPos = rayStart + rayDir * grabDistance;
 
         // ֱӽӵľλúλöΪĿλãԱקʱȶ
+        Cloth& cloth = *state->cloth;
         cloth.particles[grabbedParticleIndex].position = newWorldPos;
         cloth.particles[grabbedParticleIndex].oldPosition = newWorldPos;
+        cloth.particleChanged(grabbedParticleIndex);
     }
 }
 
@@ -608,11 +357,609 @@ void processInput(GLFWwindow* window)
     else if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) {
         key_M_pressed = false;
     }
+
+    // T key to switch surface detail
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && !key_T_pressed) {
+        key_T_pressed = true;
+        detailMode = (DetailMode)((detailMode + 1) % 3);
+
+        switch (detailMode) {
+        case DETAIL_OFF: std::cout << "Surface Detail: Off" << std::endl; break;
+        case DETAIL_GPU: std::cout << "Surface Detail: Tessellation" << std::endl; break;
+        case DETAIL_CPU: std::cout << "Surface Detail: CPU Subdivision" << std::endl; break;
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE) {
+        key_T_pressed = false;
+    }
+
+    // L key to toggle cloth level of detail
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && !key_L_pressed) {
+        key_L_pressed = true;
+        lodEnabled = !lodEnabled;
+        std::cout << "Cloth LOD: " << (lodEnabled ? "Auto" : "Full Resolution") << std::endl;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_L) == GLFW_RELEASE) {
+        key_L_pressed = false;
+    }
+
+    // G key to switch constraint solver
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !key_G_pressed) {
+        key_G_pressed = true;
+        solverMode = (SolverMode)((solverMode + 1) % (computeAvailable ? 3 : 2));
+        std::cout << "Solver: " << solverName(solverMode) << std::endl;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) {
+        key_G_pressed = false;
+    }
+
+    // R key to toggle tearing
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !key_R_pressed) {
+        key_R_pressed = true;
+        tearingEnabled = !tearingEnabled;
+        std::cout << "Tearing: " << (tearingEnabled ? "On" : "Off") << std::endl;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) {
+        key_R_pressed = false;
+    }
+
+    // P key to switch time stepping
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !key_P_pressed) {
+        key_P_pressed = true;
+        adaptiveStepping = !adaptiveStepping;
+        std::cout << "Time step: " << (adaptiveStepping ? "Adaptive" : "Fixed") << std::endl;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+        key_P_pressed = false;
+    }
+}
+
+// Picks each panel's simulated level from the last frame's camera. The panel
+// holding the grabbed particle keeps its level, since the grab is an index
+// into it, and so does a torn one, whose tear the other levels don't have,
+// and one whose state is on the GPU, where the others can't read it.
+// The chosen levels pick up the current solver mode.
+void selectClothLevels(ClothScene& scene, AppState& appState) {
+    const glm::mat4 viewProjection = appState.projection * appState.view;
+    for (int i = 0; i < scene.size(); i++) {
+        ClothLOD& lod = *scene.panel(i).lod;
+        lod.frozen = (grabbedParticleIndex != -1 && appState.cloth == &lod.active()) || !lod.active().isGrid() || lod.active().onGpu();
+        if (!lodEnabled) {
+            if (!lod.frozen) lod.setLevel(0);
+        }
+        else {
+            lod.selectLevel(viewProjection, appState.width, appState.height);
+        }
+        lod.active().solver = solverMode;
+    }
+}
+
+// Imports an OBJ garment, scaled to the default cloth's height and centred
+// where it hangs (moved by offset), pinned along its top edge: the vertices
+// within 1% of the height from the top.
+bool addGarment(ClothScene& scene, const std::string& path, glm::vec3 offset, TaskPool& pool) {
+    auto start = std::chrono::steady_clock::now();
+    ObjMesh mesh;
+    if (!loadObj(path, mesh, &pool)) return false;
+
+    glm::vec3 lo = mesh.positions[0], hi = mesh.positions[0];
+    for (const glm::vec3& p : mesh.positions) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    const float scale = hi.y > lo.y ? (CLOTH_H - 1) * 0.1f / (hi.y - lo.y) : 1.0f;
+    const glm::vec3 centre = (lo + hi) * 0.5f;
+    std::vector<Particle> particles;
+    particles.reserve(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++) {
+        Particle p((mesh.positions[i] - centre) * scale + glm::vec3(0.0f, 3.0f, 0.0f) + offset, mesh.uvs[i]);
+        p.isPinned = mesh.positions[i].y >= hi.y - 0.01f * (hi.y - lo.y);
+        particles.push_back(p);
+    }
+
+    const size_t vertexCount = particles.size(), triangleCount = mesh.indices.size() / 3;
+    ClothPanel& panel = scene.add(std::make_unique<Cloth>(std::move(particles), std::move(mesh.indices), ClothParams(), &pool), glm::vec3(0.0f));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Imported " << path << ": " << vertexCount << " vertices, " << triangleCount << " triangles, "
+        << panel.lod->active().constraints.size() << " constraints in " << elapsed.count() << " s" << std::endl;
+    return true;
+}
+
+// Default scene is the single cloth; --panels N hangs a wall of mixed-size
+// panels (curtains, flags, banners) in rows of four going back from the camera.
+// --obj FILE hangs an imported garment in place of the first cloth.
+bool buildScene(ClothScene& scene, int panelCount, TaskPool& pool) {
+    const int SIZES[][2] = { { CLOTH_W, CLOTH_H }, { 40, 80 }, { 100, 50 }, { 30, 30 }, { 160, 120 } };
+    const int PER_ROW = 4;
+    for (int i = 0; i < std::max(1, panelCount); i++) {
+        const int* size = SIZES[i % 5];
+        int row = i / PER_ROW, column = i % PER_ROW;
+        glm::vec3 offset(0.0f);
+        if (panelCount > 1) offset = glm::vec3((column - (PER_ROW - 1) * 0.5f) * 18.0f, 0.0f, -row * 8.0f);
+
+        if (i == 0 && !garmentPath.empty()) {
+            if (!addGarment(scene, garmentPath, offset, pool)) return false;
+        }
+        else {
+            scene.add(size[0], size[1], offset);
+        }
+    }
+    return true;
+}
+
+
+// ==========================================
+// Frame Helpers (shared by the window and headless paths)
+// ==========================================
+glm::vec3 computeWind(float time, float power)
+{
+    // ǰ-Zᣩ΢ƫ
+    glm::vec3 wind(sin(time * 3.0f) * (2.0f + power), 0.5f * sin(time) + power, -cos(time * 2.0f) * (2.0f + power));
+    if (power > 0.1f) wind.z -= power * 10.0f; // ¿ոʱҪ -Z 
+    return wind;
+}
+
+// GL resources used to draw a frame
+struct Renderer {
+    ShaderManager* shaders = nullptr;
+    int fabricShader = -1;
+    int tessShader = -1; // -1 without GL 4.0 tessellation
+};
+
+void renderScene(Renderer& renderer, ClothScene& scene, AppState& appState, RenderMode mode)
+{
+    glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Detail needs surfaces; the CPU path stands in when tessellation is missing
+    DetailMode detailPath = mode == POINTS ? DETAIL_OFF : detailMode;
+    if (detailPath == DETAIL_GPU && renderer.tessShader < 0) detailPath = DETAIL_CPU;
+
+    const ShaderManager& shaders = *renderer.shaders;
+    int fabricShader = detailPath == DETAIL_GPU ? renderer.tessShader : renderer.fabricShader;
+    unsigned int shaderProgram = shaders.program(fabricShader);
+
+    // Recalculate and store View/Projection matrices
+    // ʹ AppState Ķ̬
+    appState.projection = glm::perspective(glm::radians(45.0f), (float)appState.width / (float)appState.height, 0.1f, 100.0f);
+    appState.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // Under tessellation the plain program is set up too, for gridless panels
+    auto setFrameUniforms = [&](int handle) {
+        glUseProgram(shaders.program(handle));
+        glUniformMatrix4fv(shaders.uniform(handle, U_PROJECTION), 1, GL_FALSE, &appState.projection[0][0]);
+        glUniformMatrix4fv(shaders.uniform(handle, U_VIEW), 1, GL_FALSE, &appState.view[0][0]);
+        glUniformMatrix4fv(shaders.uniform(handle, U_MODEL), 1, GL_FALSE, &model[0][0]);
+
+        glUniform3f(shaders.uniform(handle, U_VIEW_POS), cameraPos.x, cameraPos.y, cameraPos.z);
+        glUniform3f(shaders.uniform(handle, U_LIGHT_POS), 5.0f, 5.0f, 10.0f);
+
+        glUniform3f(shaders.uniform(handle, U_OBJECT_COLOR), 0.6f, 0.1f, 0.2f);
+        glUniform1i(shaders.uniform(handle, U_USE_TEXTURE), false);
+    };
+    if (fabricShader != renderer.fabricShader) setFrameUniforms(renderer.fabricShader);
+    setFrameUniforms(fabricShader);
+
+    // Set Polygon Mode and Point Size based on render mode
+    switch (mode) {
+    case SHADED:
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        break;
+    case WIREFRAME:
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glLineWidth(1.5f); // ߿Աڻϸ׿߿
+        break;
+    case POINTS:
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glPointSize(pointSize);
+        break;
+    }
+
+    scene.cull(appState.projection * appState.view);
+    for (int i = 0; i < scene.size(); i++) {
+        ClothPanel& panel = scene.panel(i);
+        if (!panel.visible) continue;
+        Cloth& cloth = panel.lod->active();
+
+        if (detailPath == DETAIL_OFF) {
+            cloth.draw(shaderProgram, mode);
+            continue;
+        }
+        // Detail is built over the grid on the CPU; meshes, torn cloths and
+        // cloths on the compute solver have none
+        if (!cloth.isGrid() || cloth.onGpu()) {
+            unsigned int plainProgram = shaders.program(renderer.fabricShader);
+            if (plainProgram != shaderProgram) glUseProgram(plainProgram);
+            cloth.draw(plainProgram, mode);
+            if (plainProgram != shaderProgram) glUseProgram(shaderProgram);
+            continue;
+        }
+
+        ClothDetail& detail = *panel.detail;
+        detail.computeCompression(cloth);
+        if (detailPath == DETAIL_GPU) {
+            glUniform1f(shaders.uniform(fabricShader, U_TESS_LEVEL), static_cast<float>(detail.subdivisions));
+            glUniform2f(shaders.uniform(fabricShader, U_GRID_CELLS), static_cast<float>(cloth.width - 1), static_cast<float>(cloth.height - 1));
+            glUniform1f(shaders.uniform(fabricShader, U_WRINKLE_AMPLITUDE), detail.wrinkleAmplitude);
+            glUniform1f(shaders.uniform(fabricShader, U_WRINKLE_FREQUENCY), detail.wrinkleFrequency);
+            detail.drawTessellated(cloth);
+        }
+        else {
+            detail.drawSubdivided(cloth);
+        }
+    }
+}
+
+void initGLState()
+{
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glDisable(GL_CULL_FACE);
+}
+
+int loadFabricShader(ShaderManager& shaders)
+{
+    int handle = shaders.addProgram("fabric",
+        { { GL_VERTEX_SHADER, "fabric.vert" }, { GL_FRAGMENT_SHADER, "fabric.frag" } },
+        FABRIC_UNIFORM_NAMES);
+    if (handle < 0) {
+        std::cout << "Failed to load fabric shader program" << std::endl;
+    }
+    return handle;
+}
+
+int loadTessShader(ShaderManager& shaders)
+{
+    if (!ClothDetail::tessellationSupported()) {
+        std::cout << "Tessellation unavailable, surface detail uses CPU subdivision" << std::endl;
+        return -1;
+    }
+    return shaders.addProgram("fabric_tess",
+        { { GL_VERTEX_SHADER, "fabric_tess.vert" }, { GL_TESS_CONTROL_SHADER, "fabric_tess.tesc" },
+          { GL_TESS_EVALUATION_SHADER, "fabric_tess.tese" }, { GL_FRAGMENT_SHADER, "fabric.frag" } },
+        FABRIC_UNIFORM_NAMES);
+}
+
+// Sets computeAvailable
+bool loadComputePrograms(ShaderManager& shaders, ComputePrograms& programs)
+{
+    if (!ClothCompute::supported()) {
+        std::cout << "GL 4.3 unavailable, no compute shader solver" << std::endl;
+    }
+    else {
+        computeAvailable = programs.load(shaders);
+    }
+    if (!computeAvailable && solverMode == SOLVER_COMPUTE) {
+        std::cout << "Falling back to Gauss-Seidel" << std::endl;
+        solverMode = SOLVER_GAUSS_SEIDEL;
+    }
+    return computeAvailable;
+}
+
+// ==========================================
+// Headless Rendering (image sequence output)
+// ==========================================
+struct HeadlessOptions {
+    int frames = 300;
+    int width = SCR_WIDTH;
+    int height = SCR_HEIGHT;
+    float fps = 60.0f;
+    int ringSize = 3;
+    std::string outputDir = "frames";
+};
+
+int runHeadless(const HeadlessOptions& opts)
+{
+    HeadlessContext context;
+    if (!context.create()) return -1;
+    std::cout << "Headless rendering via " << context.backendName() << std::endl;
+    if (!context.initGlew()) return -1;
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    initGLState();
+
+    ShaderManager shaders(ShaderManager::findShaderDirectory());
+    Renderer renderer;
+    renderer.shaders = &shaders;
+    renderer.fabricShader = loadFabricShader(shaders);
+    if (renderer.fabricShader < 0) return -1;
+    if (detailMode == DETAIL_GPU) renderer.tessShader = loadTessShader(shaders);
+
+    ComputePrograms computePrograms;
+    TaskPool pool(poolThreads);
+    ClothScene scene(pool);
+    if (!buildScene(scene, scenePanels, pool)) return -1;
+    if (solverMode == SOLVER_COMPUTE && loadComputePrograms(shaders, computePrograms)) scene.enableCompute(computePrograms);
+    AppState appState;
+    appState.scene = &scene;
+    appState.width = opts.width;
+    appState.height = opts.height;
+
+    FrameCapture capture(opts.width, opts.height, opts.ringSize, opts.outputDir);
+    if (!capture.init()) return -1;
+
+    // Fixed frame time so a sequence is reproducible regardless of render speed.
+    // While the GPU (or llvmpipe's threads) renders frame N and the writer thread
+    // encodes frame N - ringSize, this thread is already stepping frame N + 1.
+    const float frameTime = 1.0f / opts.fps;
+    const float physicsStep = 0.01f;
+    float accumulator = 0.0f;
+    AdaptiveStepper stepper;
+    StepperMetrics total; // summed over the sequence
+    auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < opts.frames; frame++) {
+        if (allocWarmupFrames > 0 && frame == allocWarmupFrames) {
+            resetAllocationCounts();
+            trackAllocations(true);
+        }
+        float time = frame * frameTime;
+        glm::vec3 wind = computeWind(time, 0.0f);
+
+        setAllocationPhase(PHASE_SIMULATE);
+        selectClothLevels(scene, appState);
+        if (adaptiveStepping && solverMode == SOLVER_GAUSS_SEIDEL) {
+            stepper.beginFrame(frameTime);
+            float dt;
+            while (stepper.nextStep(dt)) {
+                scene.step(dt, wind);
+                stepper.endStep(scene.measureMotion());
+            }
+            const StepperMetrics& m = stepper.metrics();
+            if (m.substeps) {
+                total.shortestStep = total.substeps ? std::min(total.shortestStep, m.shortestStep) : m.shortestStep;
+                total.longestStep = std::max(total.longestStep, m.longestStep);
+            }
+            total.substeps += m.substeps;
+            total.droppedTime += m.droppedTime;
+            total.motion.maxStrain = std::max(total.motion.maxStrain, m.motion.maxStrain);
+        }
+        else {
+            accumulator += frameTime;
+            while (accumulator >= physicsStep) {
+                scene.step(physicsStep, wind);
+                accumulator -= physicsStep;
+            }
+        }
+
+        setAllocationPhase(PHASE_CAPTURE);
+        capture.beginFrame();
+        setAllocationPhase(PHASE_RENDER);
+        renderScene(renderer, scene, appState, currentRenderMode);
+        setAllocationPhase(PHASE_CAPTURE);
+        capture.endFrame();
+    }
+    trackAllocations(false);
+    setAllocationPhase(PHASE_OTHER);
+    capture.finish();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Wrote " << capture.framesWritten() << " frames to " << opts.outputDir << " in "
+        << elapsed.count() << " s (" << capture.framesWritten() / elapsed.count() << " fps)" << std::endl;
+    if (total.substeps) {
+        std::cout << "Adaptive steps: " << float(total.substeps) / opts.frames << " per frame, "
+            << total.shortestStep * 1000.0f << " to " << total.longestStep * 1000.0f << " ms, peak strain "
+            << total.motion.maxStrain << ", " << total.droppedTime << " s dropped" << std::endl;
+    }
+    uint64_t vertexBytes = 0;
+    for (int i = 0; i < scene.size(); i++) {
+        ClothLOD& lod = *scene.panel(i).lod;
+        for (int level = 0; level < lod.levelCount(); level++) vertexBytes += lod.level(level).uploadedBytes;
+    }
+    std::cout << "Vertex uploads: " << vertexBytes / 1024.0 / opts.frames << " KB per frame" << std::endl;
+    scene.release();
+    shaders.clear();
+
+    // Steady state must not touch the heap; fail the run if it did
+    if (allocWarmupFrames > 0 && allocWarmupFrames < opts.frames) {
+        const int tracked = opts.frames - allocWarmupFrames;
+        std::cout << "Heap allocations over " << tracked << " frames after " << allocWarmupFrames << " warm-up frames:" << std::endl;
+        if (printAllocationCounts(tracked) != 0) {
+            std::cout << "Steady-state frames allocated" << std::endl;
+            return -1;
+        }
+    }
+    return capture.framesWritten() == opts.frames ? 0 : -1;
 }
 
+// ==========================================
+// Compute Solver Validation
+// ==========================================
+// Steps the scene twice from the same start, on the CPU (Gauss-Seidel) and
+// in compute shaders, and compares the particles every VALIDATE_INTERVAL
+// steps. The GPU rounds differently, and a cloth amplifies small
+// differences over time, so after each comparison the GPU copy restarts
+// from the CPU state: each check measures one interval's worth of error.
+const int VALIDATE_INTERVAL = 10;
+const float VALIDATE_POSITION_TOLERANCE = 1e-3f; // a hundredth of the grid spacing
+const float VALIDATE_NORMAL_TOLERANCE = 1e-2f;
+
+int runComputeValidation(int steps)
+{
+    HeadlessContext context;
+    if (!context.create() || !context.initGlew()) return -1;
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    if (!ClothCompute::supported()) {
+        std::cout << "Compute validation needs GL 4.3" << std::endl;
+        return -1;
+    }
+
+    ShaderManager shaders(ShaderManager::findShaderDirectory());
+    ComputePrograms programs;
+    if (!programs.load(shaders)) return -1;
+
+    TaskPool pool(poolThreads);
+    ClothScene reference(pool), gpu(pool);
+    if (!buildScene(reference, scenePanels, pool) || !buildScene(gpu, scenePanels, pool)) return -1;
+    gpu.enableCompute(programs);
+    for (int i = 0; i < gpu.size(); i++) gpu.panel(i).lod->active().solver = SOLVER_COMPUTE;
+
+    float worstPosition = 0.0f, worstNormal = 0.0f;
+    double cpuSeconds = 0.0, gpuSeconds = 0.0;
+    for (int step = 1; step <= steps; step++) {
+        glm::vec3 wind = computeWind(step * TIME_STEP, 0.0f);
+
+        auto start = std::chrono::steady_clock::now();
+        reference.step(TIME_STEP, wind);
+        auto middle = std::chrono::steady_clock::now();
+        gpu.step(TIME_STEP, wind);
+        glFinish();
+        cpuSeconds += std::chrono::duration<double>(middle - start).count();
+        gpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count();
+        if (step % VALIDATE_INTERVAL != 0 && step != steps) continue;
+
+        float positionError = 0.0f, normalError = 0.0f;
+        for (int i = 0; i < gpu.size(); i++) {
+            Cloth& expected = reference.panel(i).lod->active();
+            Cloth& actual = gpu.panel(i).lod->active();
+            actual.fetchFromGpu();
+            for (size_t k = 0; k < actual.particles.size(); k++) {
+                Particle& p = actual.particles[k];
+                const Particle& q = expected.particles[k];
+                positionError = std::max(positionError, glm::length(p.position - q.position));
+                normalError = std::max(normalError, glm::length(p.normal - q.normal));
+                p.position = q.position;
+                p.oldPosition = q.oldPosition;
+                p.normal = q.normal;
+                p.tangent = q.tangent;
+            }
+            actual.compute->upload(actual);
+        }
+        printf("step %5d: position error %.3g, normal error %.3g\n", step, positionError, normalError);
+        worstPosition = std::max(worstPosition, positionError);
+        worstNormal = std::max(worstNormal, normalError);
+    }
+    printf("CPU %.3f ms/step, GPU %.3f ms/step\n", cpuSeconds * 1000.0 / steps, gpuSeconds * 1000.0 / steps);
+
+    reference.release();
+    gpu.release();
+    shaders.clear();
+
+    // NaN fails too
+    if (!(worstPosition <= VALIDATE_POSITION_TOLERANCE && worstNormal <= VALIDATE_NORMAL_TOLERANCE)) {
+        printf("Compute solver differs from the CPU solver: position %.3g (tolerance %.3g), normal %.3g (tolerance %.3g)\n",
+            worstPosition, VALIDATE_POSITION_TOLERANCE, worstNormal, VALIDATE_NORMAL_TOLERANCE);
+        return -1;
+    }
+    std::cout << "Compute solver matches the CPU solver" << std::endl;
+    return 0;
+}
 
-int main()
+
+int main(int argc, char** argv)
 {
+    // Headless: silksolution --headless [--frames N] [--size WxH] [--fps F] [--ring N] [--out DIR]
+    //                        [--detail off|gpu|cpu] [--lod on|off] [--solver gs|multigrid|compute]
+    // Both modes: [--panels N] [--threads N] [--obj FILE] [--stepping adaptive|fixed] [--alloc-check WARMUP]
+    // Sweeps:   silksolution --batch SWEEP [--out FILE] [--threads N]   (see src/BatchRunner.h)
+    //           silksolution --dump FILE                                (column file as CSV)
+    // Layout:   silksolution --layout-bench FILE [--threads N]          (see src/MeshOrder.h)
+    // Compute:  silksolution --validate-compute STEPS [--panels N] [--obj FILE]
+    //           (compares the compute shader solver with the CPU one, see src/ClothCompute.h)
+    // Kernels:  silksolution --kernel-bench FILE [--baseline FILE] [--threshold PCT] [--sizes 32,64]
+    //                        [--thread-counts 1,4] [--reps N] [--filter TEXT]   (see src/KernelBench.h)
+    //           silksolution --bench-compare FILE --baseline FILE [--threshold PCT]
+    HeadlessOptions headless;
+    bool headlessMode = false;
+    BatchOptions batch;
+    std::string layoutBenchPath;
+    int validateSteps = 0;
+    KernelBenchOptions kernelBench;
+    bool kernelBenchMode = false;
+    std::string benchComparePath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--headless") { headlessMode = true; continue; }
+        else if (arg == "--frames") headless.frames = std::max(1, atoi(value));
+        else if (arg == "--fps") headless.fps = std::max(1.0f, (float)atof(value));
+        else if (arg == "--ring") headless.ringSize = std::max(2, atoi(value));
+        else if (arg == "--out") headless.outputDir = batch.outputFile = value;
+        else if (arg == "--panels") scenePanels = std::max(1, atoi(value));
+        else if (arg == "--threads") poolThreads = batch.threads = std::max(0, atoi(value));
+        else if (arg == "--obj") garmentPath = value;
+        else if (arg == "--alloc-check") allocWarmupFrames = std::max(1, atoi(value));
+        else if (arg == "--batch") batch.sweepFile = value;
+        else if (arg == "--dump") return dumpColumnFile(value);
+        else if (arg == "--layout-bench") layoutBenchPath = value;
+        else if (arg == "--validate-compute") validateSteps = std::max(1, atoi(value));
+        else if (arg == "--kernel-bench") { kernelBenchMode = true; kernelBench.outputFile = value; }
+        else if (arg == "--bench-compare") benchComparePath = value;
+        else if (arg == "--baseline") kernelBench.baselineFile = value;
+        else if (arg == "--threshold") kernelBench.threshold = std::max(0.0, atof(value));
+        else if (arg == "--reps") kernelBench.repetitions = std::max(1, atoi(value));
+        else if (arg == "--filter") kernelBench.filter = value;
+        else if (arg == "--sizes" || arg == "--thread-counts") {
+            std::vector<int>& list = arg == "--sizes" ? kernelBench.sizes : kernelBench.threadCounts;
+            if (!parseIntList(value, list)) {
+                std::cout << "Invalid " << arg << ", expected a list like 32,64,128" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--detail") {
+            std::string mode = value;
+            if (mode == "off") detailMode = DETAIL_OFF;
+            else if (mode == "gpu") detailMode = DETAIL_GPU;
+            else if (mode == "cpu") detailMode = DETAIL_CPU;
+            else {
+                std::cout << "Invalid --detail, expected off, gpu or cpu" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--lod") {
+            std::string mode = value;
+            if (mode == "on") lodEnabled = true;
+            else if (mode == "off") lodEnabled = false;
+            else {
+                std::cout << "Invalid --lod, expected on or off" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--stepping") {
+            std::string mode = value;
+            if (mode == "adaptive") adaptiveStepping = true;
+            else if (mode == "fixed") adaptiveStepping = false;
+            else {
+                std::cout << "Invalid --stepping, expected adaptive or fixed" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--solver") {
+            std::string mode = value;
+            if (mode == "gs") solverMode = SOLVER_GAUSS_SEIDEL;
+            else if (mode == "multigrid") solverMode = SOLVER_MULTIGRID;
+            else if (mode == "compute") solverMode = SOLVER_COMPUTE;
+            else {
+                std::cout << "Invalid --solver, expected gs, multigrid or compute" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--size") {
+            if (sscanf(value, "%dx%d", &headless.width, &headless.height) != 2 || headless.width <= 0 || headless.height <= 0) {
+                std::cout << "Invalid --size, expected WxH" << std::endl;
+                return -1;
+            }
+        }
+        else {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+        i++;
+    }
+    if (!batch.sweepFile.empty()) return runBatch(batch, computeWind);
+    if (!layoutBenchPath.empty()) return runLayoutBenchmark(layoutBenchPath, poolThreads);
+    if (validateSteps > 0) return runComputeValidation(validateSteps);
+    if (kernelBenchMode) return runKernelBenchmarks(kernelBench, getParticleIndexUnderCursor);
+    if (!benchComparePath.empty()) {
+        if (kernelBench.baselineFile.empty()) {
+            std::cout << "--bench-compare needs --baseline FILE" << std::endl;
+            return -1;
+        }
+        return compareKernelBenchmarks(benchComparePath, kernelBench.baselineFile, kernelBench.threshold);
+    }
+    if (headlessMode) return runHeadless(headless);
+
     // 1. Initialize GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -635,33 +982,32 @@ int main()
         return -1;
     }
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_PROGRAM_POINT_SIZE);
-    glDisable(GL_CULL_FACE);
-
-    // 3. Compile Shader 
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    initGLState();
 
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // 3. Load Shader (binary cache + hot reload)
+    ShaderManager shaders(ShaderManager::findShaderDirectory());
+    Renderer renderer;
+    renderer.shaders = &shaders;
+    renderer.fabricShader = loadFabricShader(shaders);
+    if (renderer.fabricShader < 0) {
+        glfwTerminate();
+        return -1;
+    }
+    renderer.tessShader = loadTessShader(shaders);
 
-    // 4. Initialize Cloth
-    Cloth cloth(CLOTH_W, CLOTH_H);
+    // 4. Initialize Cloth panels (each with full, 1/2 and 1/4 resolution levels)
+    ComputePrograms computePrograms;
+    TaskPool pool(poolThreads);
+    ClothScene scene(pool);
+    if (!buildScene(scene, scenePanels, pool)) {
+        glfwTerminate();
+        return -1;
+    }
+    if (loadComputePrograms(shaders, computePrograms)) scene.enableCompute(computePrograms);
 
     // 5. Setup GLFW User Pointer and Callbacks
     AppState appState;
-    appState.cloth = &cloth;
+    appState.scene = &scene;
     glfwSetWindowUserPointer(window, &appState);
 
     glfwSetCursorPosCallback(window, cursor_position_callback);
@@ -671,71 +1017,74 @@ int main()
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
     // 6. Render Loop
+    AdaptiveStepper stepper;
+    float lastTitleUpdate = 0.0f;
+    int frameCount = 0;
     while (!glfwWindowShouldClose(window))
     {
+        if (allocWarmupFrames > 0 && frameCount++ == allocWarmupFrames) {
+            resetAllocationCounts();
+            trackAllocations(true);
+        }
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        setAllocationPhase(PHASE_INPUT);
         processInput(window);
 
         // Physics Update
-        float time = currentFrame;
-        // ǰ-Zᣩ΢ƫ
-        glm::vec3 wind(sin(time * 3.0f) * (2.0f + windPower), 0.5f * sin(time) + windPower, -cos(time * 2.0f) * (2.0f + windPower));
-        if (windPower > 0.1f) wind.z -= windPower * 10.0f; // ¿ոʱҪ -Z 
-
-        float physicsStep = 0.01f;
-        float accumulator = deltaTime;
-        if (accumulator > 0.05f) accumulator = 0.05f;
-        while (accumulator >= physicsStep) {
-            cloth.update(physicsStep, wind);
-            accumulator -= physicsStep;
+        glm::vec3 wind = computeWind(currentFrame, windPower);
+
+        setAllocationPhase(PHASE_SIMULATE);
+        selectClothLevels(scene, appState);
+        if (adaptiveStepping && solverMode == SOLVER_GAUSS_SEIDEL) {
+            stepper.beginFrame(deltaTime);
+            float dt;
+            while (stepper.nextStep(dt)) {
+                scene.step(dt, wind);
+                if (tearingEnabled && grabbedParticleIndex != -1) appState.cloth->tear(grabbedParticleIndex);
+                stepper.endStep(scene.measureMotion());
+            }
+            // The chosen steps, twice a second
+            if (currentFrame - lastTitleUpdate > 0.5f) {
+                const StepperMetrics& m = stepper.metrics();
+                char title[160];
+                snprintf(title, sizeof(title), "Silk Simulation - OpenGL | %d substeps of %.1f-%.1f ms, strain %.2f",
+                    m.substeps, m.shortestStep * 1000.0f, m.longestStep * 1000.0f, m.motion.maxStrain);
+                glfwSetWindowTitle(window, title);
+                lastTitleUpdate = currentFrame;
+            }
         }
-
-        // Render
-        glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(shaderProgram);
-
-        // Recalculate and store View/Projection matrices
-        // ʹ AppState Ķ̬
-        appState.projection = glm::perspective(glm::radians(45.0f), (float)appState.width / (float)appState.height, 0.1f, 100.0f);
-        appState.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        glm::mat4 model = glm::mat4(1.0f);
-
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &appState.projection[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, &appState.view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
-
-        glUniform3f(glGetUniformLocation(shaderProgram, "viewPos"), cameraPos.x, cameraPos.y, cameraPos.z);
-        glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), 5.0f, 5.0f, 10.0f);
-
-        glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.6f, 0.1f, 0.2f);
-        glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), false);
-
-        // Set Polygon Mode and Point Size based on render mode
-        switch (currentRenderMode) {
-        case SHADED:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            break;
-        case WIREFRAME:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glLineWidth(1.5f); // ߿Աڻϸ׿߿
-            break;
-        case POINTS:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glPointSize(pointSize);
-            break;
+        else {
+            float physicsStep = 0.01f;
+            float accumulator = deltaTime;
+            if (accumulator > 0.05f) accumulator = 0.05f;
+            while (accumulator >= physicsStep) {
+                scene.step(physicsStep, wind);
+                if (tearingEnabled && grabbedParticleIndex != -1) appState.cloth->tear(grabbedParticleIndex);
+                accumulator -= physicsStep;
+            }
         }
 
-        cloth.draw(shaderProgram, currentRenderMode);
+        // Render
+        setAllocationPhase(PHASE_RENDER);
+        shaders.pollChanges(currentFrame);
+        renderScene(renderer, scene, appState, currentRenderMode);
 
         glfwSwapBuffers(window);
+        setAllocationPhase(PHASE_INPUT);
         glfwPollEvents();
     }
+    trackAllocations(false);
+    setAllocationPhase(PHASE_OTHER);
+    if (allocWarmupFrames > 0 && frameCount > allocWarmupFrames) {
+        std::cout << "Heap allocations over " << frameCount - allocWarmupFrames << " frames after " << allocWarmupFrames << " warm-up frames:" << std::endl;
+        printAllocationCounts(frameCount - allocWarmupFrames);
+    }
 
+    scene.release();
+    shaders.clear();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
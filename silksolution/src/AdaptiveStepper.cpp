@@ -0,0 +1,54 @@
+#include "AdaptiveStepper.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Aim a little under the limits so the step doesn't flip between two sizes
+const float SAFETY = 0.9f;
+
+} // namespace
+
+AdaptiveStepper::AdaptiveStepper(const StepperParams& stepperParams)
+    : params(stepperParams), step(std::clamp(0.01f, stepperParams.minStep, stepperParams.maxStep)) {
+}
+
+void AdaptiveStepper::beginFrame(float frameTime) {
+    frame = StepperMetrics();
+    frameTime = std::max(frameTime, 0.0f);
+    if (frameTime > params.maxFrameTime) {
+        frame.droppedTime = frameTime - params.maxFrameTime;
+        frameTime = params.maxFrameTime;
+    }
+    remaining += frameTime;
+}
+
+bool AdaptiveStepper::nextStep(float& dt) {
+    if (remaining >= step && frame.substeps >= params.maxSubsteps) {
+        frame.droppedTime += remaining;
+        remaining = 0.0f;
+    }
+    if (remaining < step) {
+        finished = frame;
+        return false;
+    }
+    dt = current = step;
+    remaining -= step;
+    return true;
+}
+
+void AdaptiveStepper::endStep(const ClothMotion& motion) {
+    frame.shortestStep = frame.substeps ? std::min(frame.shortestStep, current) : current;
+    frame.longestStep = std::max(frame.longestStep, current);
+    frame.substeps++;
+    frame.simulatedTime += current;
+    if (!(motion.maxStrain <= frame.motion.maxStrain)) frame.motion.maxStrain = motion.maxStrain;
+    frame.motion.maxSpeed = std::max(frame.motion.maxSpeed, motion.maxSpeed);
+
+    float scale = params.growth;
+    if (motion.maxStrain > 0.0f) scale = std::min(scale, SAFETY * std::sqrt(params.targetStrain / motion.maxStrain));
+    if (motion.maxSpeed > 0.0f) scale = std::min(scale, SAFETY * params.maxTravel / (motion.maxSpeed * current));
+    if (motion.maxStrain != motion.maxStrain) scale = 0.0f; // blew up: as short as allowed
+    step = std::clamp(current * scale, params.minStep, params.maxStep);
+}
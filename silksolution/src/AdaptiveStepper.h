@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Cloth.h"
+
+// ==========================================
+// Adaptive Substepping
+// ==========================================
+// Chooses the physics step from how hard the cloth moves instead of a fixed
+// 0.01 s. After every substep the caller reports the largest structural
+// strain and particle speed (Cloth::measureMotion). PBD stretch grows with
+// about the square of the step, so the next step is scaled by the square
+// root of targetStrain over the strain seen, and it is also kept short
+// enough that no particle moves more than maxTravel. Calm frames let the
+// step grow again, by at most growth per substep, up to maxStep.
+//
+// Each frame runs at most maxSubsteps substeps. If the frame needs more,
+// the rest of its time is dropped: a heavy frame plays in slow motion
+// instead of stalling the next one. Time shorter than a step carries over
+// to the next frame, as with a fixed step.
+//
+// This models the Gauss-Seidel solver. Multigrid V-cycles stretch the cloth
+// more on short steps than on 0.01 s ones, so the app keeps it on the fixed
+// step.
+//
+//     stepper.beginFrame(frameTime);
+//     float dt;
+//     while (stepper.nextStep(dt)) {
+//         scene.step(dt, wind);
+//         stepper.endStep(scene.measureMotion());
+//     }
+struct StepperParams {
+    float minStep = 0.002f;
+    float maxStep = 0.02f;
+    int maxSubsteps = 12;       // per frame
+    float maxFrameTime = 0.05f; // longer frames (a stall, a breakpoint) count as this
+    // Below TEAR_STRAIN, so links tear from pulling, not from the step size
+    float targetStrain = 0.5f;
+    float maxTravel = 0.1f;     // world units a particle may move in one substep (a grid spacing)
+    float growth = 1.25f;
+};
+
+// What the stepper chose, for the last finished frame
+struct StepperMetrics {
+    int substeps = 0;
+    float shortestStep = 0.0f, longestStep = 0.0f;
+    float simulatedTime = 0.0f;
+    float droppedTime = 0.0f; // cut by maxFrameTime or maxSubsteps
+    ClothMotion motion;       // the worst seen after any substep
+};
+
+class AdaptiveStepper {
+public:
+    explicit AdaptiveStepper(const StepperParams& stepperParams = StepperParams());
+
+    void beginFrame(float frameTime);
+    // Length of the next substep, or false once the frame is covered.
+    bool nextStep(float& dt);
+    void endStep(const ClothMotion& motion);
+
+    // Length the next substep would like to have
+    float stepSize() const { return step; }
+    const StepperMetrics& metrics() const { return finished; }
+
+    StepperParams params;
+
+private:
+    float step;
+    float remaining = 0.0f; // frame time not simulated yet
+    float current = 0.0f;   // the substep in flight
+    StepperMetrics frame, finished;
+};
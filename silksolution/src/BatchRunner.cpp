@@ -0,0 +1,293 @@
+#include "BatchRunner.h"
+
+#include "Cloth.h"
+#include "ClothMultigrid.h"
+#include "ColumnFile.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const float PHYSICS_STEP = 0.01f;
+
+// Values per swept parameter; every combination is one run.
+struct Sweep {
+    std::vector<std::pair<int, int>> sizes{ { 60, 60 } };
+    std::vector<float> damping{ DAMPING };
+    std::vector<float> iterations{ static_cast<float>(CONSTRAINT_ITERATIONS) };
+    std::vector<float> structural{ STRUCTURAL_STIFFNESS };
+    std::vector<float> shear{ SHEAR_STIFFNESS };
+    std::vector<float> bending{ BENDING_STIFFNESS };
+    std::vector<float> wind{ 0.0f };
+    std::vector<float> solver{ static_cast<float>(SOLVER_GAUSS_SEIDEL) };
+    std::vector<float> steps{ 500.0f };
+
+    // Dimension sizes, slowest varying first
+    std::vector<size_t> dims() const {
+        return { sizes.size(), damping.size(), iterations.size(), structural.size(), shear.size(),
+                 bending.size(), wind.size(), solver.size(), steps.size() };
+    }
+};
+
+struct Run {
+    int width, height;
+    ClothParams params;
+    float wind;
+    SolverMode solver;
+    int steps;
+};
+
+enum MetricColumn {
+    C_RUN, C_WIDTH, C_HEIGHT, C_DAMPING, C_ITERATIONS, C_STRUCTURAL, C_SHEAR, C_BENDING, C_WIND,
+    C_SOLVER, C_STEPS, C_RESIDUAL, C_MAX_STRETCH, C_STEP_US, C_COUNT
+};
+
+const std::vector<ColumnFile::Column> METRIC_COLUMNS = {
+    { "run", ColumnFile::INT32 }, { "width", ColumnFile::INT32 }, { "height", ColumnFile::INT32 },
+    { "damping", ColumnFile::FLOAT32 }, { "iterations", ColumnFile::INT32 },
+    { "structural", ColumnFile::FLOAT32 }, { "shear", ColumnFile::FLOAT32 }, { "bending", ColumnFile::FLOAT32 },
+    { "wind", ColumnFile::FLOAT32 }, { "solver", ColumnFile::INT32 }, { "steps", ColumnFile::INT32 },
+    { "residual", ColumnFile::FLOAT32 }, { "max_stretch", ColumnFile::FLOAT32 }, { "step_us", ColumnFile::FLOAT32 }
+};
+
+// "1 2 3", "0.9:0.99:0.01" or a mix of both
+bool parseValues(std::istringstream& in, std::vector<float>& values) {
+    values.clear();
+    std::string token;
+    while (in >> token) {
+        float first, last, step;
+        if (sscanf(token.c_str(), "%f:%f:%f", &first, &last, &step) == 3) {
+            if (step <= 0.0f || last < first) return false;
+            int count = static_cast<int>((last - first) / step + 1e-3f) + 1;
+            // The rounding of first + i * step may overshoot last a little
+            for (int i = 0; i < count; i++) values.push_back(std::min(first + i * step, last));
+        }
+        else {
+            char* end = nullptr;
+            float v = strtof(token.c_str(), &end);
+            if (*end != '\0') return false;
+            values.push_back(v);
+        }
+    }
+    return !values.empty();
+}
+
+// Whole numbers from 1, for counts (iterations, steps)
+bool allCounts(const std::vector<float>& values) {
+    for (float v : values) {
+        if (!(v >= 1.0f && v <= 1e9f) || v != std::floor(v)) return false;
+    }
+    return true;
+}
+
+// Factors in [0, 1] (damping, stiffnesses)
+bool allFractions(const std::vector<float>& values) {
+    for (float v : values) {
+        if (!(v >= 0.0f && v <= 1.0f)) return false;
+    }
+    return true;
+}
+
+bool parseSweep(const std::string& path, Sweep& sweep) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "Failed to open sweep file " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string key;
+        if (!(fields >> key)) continue;
+
+        bool ok = true;
+        if (key == "size") {
+            sweep.sizes.clear();
+            std::string token;
+            while (ok && fields >> token) {
+                int w = 0, h = 0;
+                ok = sscanf(token.c_str(), "%dx%d", &w, &h) == 2 && w >= 3 && h >= 3;
+                sweep.sizes.emplace_back(w, h);
+            }
+            ok = ok && !sweep.sizes.empty();
+        }
+        else if (key == "solver") {
+            sweep.solver.clear();
+            std::string token;
+            while (ok && fields >> token) {
+                ok = token == "gs" || token == "multigrid";
+                sweep.solver.push_back(static_cast<float>(token == "gs" ? SOLVER_GAUSS_SEIDEL : SOLVER_MULTIGRID));
+            }
+            ok = ok && !sweep.solver.empty();
+        }
+        else if (key == "damping") ok = parseValues(fields, sweep.damping) && allFractions(sweep.damping);
+        else if (key == "iterations") ok = parseValues(fields, sweep.iterations) && allCounts(sweep.iterations);
+        else if (key == "structural") ok = parseValues(fields, sweep.structural) && allFractions(sweep.structural);
+        else if (key == "shear") ok = parseValues(fields, sweep.shear) && allFractions(sweep.shear);
+        else if (key == "bending") ok = parseValues(fields, sweep.bending) && allFractions(sweep.bending);
+        else if (key == "wind") ok = parseValues(fields, sweep.wind);
+        else if (key == "steps") ok = parseValues(fields, sweep.steps) && allCounts(sweep.steps);
+        else {
+            std::cout << path << ":" << lineNumber << ": unknown parameter " << key << std::endl;
+            return false;
+        }
+
+        if (!ok) {
+            std::cout << path << ":" << lineNumber << ": invalid values for " << key << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+Run runAt(const Sweep& sweep, size_t index) {
+    std::vector<size_t> dims = sweep.dims();
+    size_t digit[9];
+    for (int d = static_cast<int>(dims.size()) - 1; d >= 0; d--) {
+        digit[d] = index % dims[d];
+        index /= dims[d];
+    }
+
+    Run run;
+    run.width = sweep.sizes[digit[0]].first;
+    run.height = sweep.sizes[digit[0]].second;
+    run.params.damping = sweep.damping[digit[1]];
+    run.params.constraintIterations = static_cast<int>(sweep.iterations[digit[2]]);
+    run.params.structuralStiffness = sweep.structural[digit[3]];
+    run.params.shearStiffness = sweep.shear[digit[4]];
+    run.params.bendingStiffness = sweep.bending[digit[5]];
+    run.wind = sweep.wind[digit[6]];
+    run.solver = static_cast<SolverMode>(static_cast<int>(sweep.solver[digit[7]]));
+    run.steps = static_cast<int>(sweep.steps[digit[8]]);
+    return run;
+}
+
+void simulate(const Run& run, WindProfile windProfile, ColumnFile::Value* row) {
+    Cloth cloth(run.width, run.height, run.params);
+    cloth.solver = run.solver;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < run.steps; s++) {
+        cloth.update(PHYSICS_STEP, windProfile(s * PHYSICS_STEP, run.wind));
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    float maxStretch = 0.0f;
+    for (const auto& c : cloth.constraints) {
+        if (c.type != STRUCTURAL) continue;
+        float stretch = glm::distance(c.p1->position, c.p2->position) / c.restDistance;
+        if (!(stretch <= maxStretch)) maxStretch = stretch; // keeps a NaN from a blown-up run
+    }
+
+    row[C_WIDTH].i = run.width;
+    row[C_HEIGHT].i = run.height;
+    row[C_DAMPING].f = run.params.damping;
+    row[C_ITERATIONS].i = run.params.constraintIterations;
+    row[C_STRUCTURAL].f = run.params.structuralStiffness;
+    row[C_SHEAR].f = run.params.shearStiffness;
+    row[C_BENDING].f = run.params.bendingStiffness;
+    row[C_WIND].f = run.wind;
+    row[C_SOLVER].i = run.solver;
+    row[C_STEPS].i = run.steps;
+    row[C_RESIDUAL].f = ClothMultigrid::residual(cloth);
+    row[C_MAX_STRETCH].f = maxStretch;
+    row[C_STEP_US].f = run.steps ? static_cast<float>(elapsed.count() / run.steps) : 0.0f;
+}
+
+// Shared between the pool tasks
+struct BatchState {
+    const Sweep* sweep;
+    WindProfile windProfile;
+    size_t runCount;
+    std::atomic<size_t> next{ 0 };
+    std::mutex outputLock;
+    ColumnFile::Writer writer;
+    size_t done = 0;
+};
+
+} // namespace
+
+int runBatch(const BatchOptions& opts, WindProfile windProfile) {
+    Sweep sweep;
+    if (!parseSweep(opts.sweepFile, sweep)) return -1;
+
+    BatchState state;
+    state.sweep = &sweep;
+    state.windProfile = windProfile;
+    state.runCount = 1;
+    for (size_t d : sweep.dims()) state.runCount *= d;
+    if (!state.writer.open(opts.outputFile, METRIC_COLUMNS)) return -1;
+
+    TaskPool pool(opts.threads);
+    std::cout << "Sweeping " << state.runCount << " runs on " << pool.threadCount() << " threads" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    // One long-lived task per thread pulling run indices, so thousands of runs
+    // never sit in the deques and slow runs do not stall a fixed partition.
+    TaskPool::Group group;
+    for (int t = 0; t < pool.threadCount(); t++) {
+        pool.spawn(group, [](void* context, int) {
+            BatchState& s = *static_cast<BatchState*>(context);
+            ColumnFile::Value row[C_COUNT];
+            for (size_t i = s.next++; i < s.runCount; i = s.next++) {
+                row[C_RUN].i = static_cast<int32_t>(i);
+                simulate(runAt(*s.sweep, i), s.windProfile, row);
+
+                std::lock_guard<std::mutex> lk(s.outputLock);
+                s.writer.append(row);
+                s.done++;
+                if (s.done % std::max<size_t>(1, s.runCount / 20) == 0) {
+                    std::cout << "  " << s.done << " / " << s.runCount << " runs" << std::endl;
+                }
+            }
+        }, &state, t);
+    }
+    pool.wait(group);
+    state.writer.close();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Wrote " << state.writer.rowsWritten() << " runs to " << opts.outputFile << " in "
+        << elapsed.count() << " s (" << state.writer.rowsWritten() / elapsed.count() << " runs/s)" << std::endl;
+    return state.writer.rowsWritten() == static_cast<int>(state.runCount) ? 0 : -1;
+}
+
+int dumpColumnFile(const std::string& path) {
+    ColumnFile::Reader reader;
+    if (!reader.open(path)) return -1;
+
+    const auto& columns = reader.columns();
+    for (size_t c = 0; c < columns.size(); c++) {
+        printf("%s%s", c ? "," : "", columns[c].name.c_str());
+    }
+    printf("\n");
+
+    std::vector<ColumnFile::Value> values;
+    int rows = 0;
+    while (reader.nextGroup(values, rows)) {
+        for (int r = 0; r < rows; r++) {
+            for (size_t c = 0; c < columns.size(); c++) {
+                const ColumnFile::Value& v = values[c * rows + r];
+                if (columns[c].type == ColumnFile::INT32) printf("%s%d", c ? "," : "", v.i);
+                else printf("%s%g", c ? "," : "", v.f);
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
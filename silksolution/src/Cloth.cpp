@@ -0,0 +1,884 @@
+#include "Cloth.h"
+#include "ClothCompute.h"
+#include "ClothMultigrid.h"
+#include "FrameMemory.h"
+#include "MeshOrder.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+static_assert(PARALLEL_GRAIN % UPLOAD_BLOCK == 0, "parallel chunks flag whole upload blocks");
+
+Cloth::Cloth(int w, int h, const ClothParams& clothParams) : width(w), height(h), params(clothParams) {
+    particles.reserve(w * h);
+    float spacing = 0.1f;
+
+    // ʼ񣬲΢̧ߣʹ䴦Ұ
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            // ʼλ Y=3.0f 
+            glm::vec3 pos((x - w / 2.0f) * spacing, 3.0f + (y - h / 2.0f) * spacing, 0.0f);
+            glm::vec2 uv((float)x / (w - 1), (float)y / (h - 1));
+            Particle p(pos, uv);
+
+            // סԵӣÿ5̶һ
+            if (y == h - 1 && (x % 5 == 0)) {
+                p.isPinned = true;
+            }
+            particles.push_back(p);
+        }
+    }
+
+    buildTopology();
+}
+
+Cloth::Cloth(int w, int h, std::vector<Particle> gridParticles, const ClothParams& clothParams)
+    : width(w), height(h), particles(std::move(gridParticles)), params(clothParams) {
+    buildTopology();
+}
+
+Cloth::Cloth(std::vector<Particle> meshParticles, std::vector<unsigned int> triangles, const ClothParams& clothParams, TaskPool* pool)
+    : width(0), height(0), particles(std::move(meshParticles)), indices(std::move(triangles)), params(clothParams) {
+    if (particles.size() < PARALLEL_MIN_PARTICLES) pool = nullptr;
+    if (params.reorderMesh) reorderMesh();
+    particles.reserve(particles.size() + particles.size() / TEAR_SPARE_DIVISOR);
+    buildVertexTriangles();
+    buildMeshConstraints(pool);
+    if (params.reorderMesh) sortMeshConstraints();
+    colorConstraints();
+    recalculateNormals(pool);
+}
+
+Cloth::~Cloth() = default;
+
+void Cloth::buildTopology() {
+    const int w = width;
+    const int h = height;
+    particles.reserve(particles.size() + particles.size() / TEAR_SPARE_DIVISOR);
+
+    auto addConstraint = [&](int x1, int y1, int x2, int y2, float k, ConstraintType type) {
+        if (x1 >= 0 && x1 < w && y1 >= 0 && y1 < h &&
+            x2 >= 0 && x2 < w && y2 >= 0 && y2 < h) {
+            constraints.emplace_back(&particles[y1 * w + x1], &particles[y2 * w + x2], k, type);
+        }
+        };
+
+    // Լ
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            // Structural (ṹԼ)
+            addConstraint(x, y, x + 1, y, params.structuralStiffness, STRUCTURAL);
+            addConstraint(x, y, x, y + 1, params.structuralStiffness, STRUCTURAL);
+
+            // Shear (Լ)
+            addConstraint(x, y, x + 1, y + 1, params.shearStiffness, SHEAR);
+            addConstraint(x, y, x - 1, y + 1, params.shearStiffness, SHEAR);
+
+            // Bending (Լ) - ֲ״
+            addConstraint(x, y, x + 2, y, params.bendingStiffness, BENDING);
+            addConstraint(x, y, x, y + 2, params.bendingStiffness, BENDING);
+        }
+    }
+
+    // 
+    for (int y = 0; y < h - 1; y++) {
+        for (int x = 0; x < w - 1; x++) {
+            int topLeft = y * w + x;
+            int topRight = topLeft + 1;
+            int bottomLeft = (y + 1) * w + x;
+            int bottomRight = bottomLeft + 1;
+
+            // Triangle 1
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
+
+            // Triangle 2
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
+        }
+    }
+
+    colorConstraints();
+    buildVertexTriangles();
+
+    boundsMin = glm::vec3(FLT_MAX);
+    boundsMax = glm::vec3(-FLT_MAX);
+    for (const auto& p : particles) {
+        boundsMin = glm::min(boundsMin, p.position);
+        boundsMax = glm::max(boundsMax, p.position);
+    }
+
+    // Coarse levels are measured on the rest layout; keep it for when (if
+    // ever) the multigrid solver first runs.
+    restPositions.resize(particles.size());
+    for (size_t i = 0; i < particles.size(); i++) restPositions[i] = particles[i].position;
+}
+
+void Cloth::buildVertexTriangles() {
+    // Triangles around each vertex, ascending
+    vertexTriangleCounts.assign(particles.size(), 0);
+    for (unsigned int index : indices) vertexTriangleCounts[index]++;
+    vertexTriangleOffsets.resize(particles.size());
+    unsigned int offset = 0;
+    for (size_t i = 0; i < particles.size(); i++) {
+        vertexTriangleOffsets[i] = offset;
+        offset += vertexTriangleCounts[i];
+    }
+    vertexTriangles.resize(indices.size());
+    std::vector<unsigned int> cursor(vertexTriangleOffsets);
+    for (size_t i = 0; i < indices.size(); i++) vertexTriangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    faceNormals.resize(indices.size() / 3);
+    faceTangents.resize(indices.size() / 3);
+}
+
+void Cloth::reorderMesh() {
+    // Particles along a Hilbert curve of their rest positions, then the
+    // triangles by their lowest corner, so the cache ordering below walks
+    // memory in the same direction, then in vertex cache order. The links
+    // are built from both afterwards.
+    std::vector<glm::vec3> rest(particles.size());
+    for (size_t i = 0; i < particles.size(); i++) rest[i] = particles[i].position;
+    std::vector<unsigned int> order = hilbertOrder(rest);
+
+    std::vector<unsigned int> remap(particles.size());
+    std::vector<Particle> sorted;
+    sorted.reserve(particles.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted.push_back(particles[order[i]]);
+        remap[order[i]] = static_cast<unsigned int>(i);
+    }
+    particles.swap(sorted);
+    for (unsigned int& index : indices) index = remap[index];
+
+    std::vector<uint64_t> keys(indices.size() / 3);
+    for (size_t t = 0; t < keys.size(); t++) {
+        unsigned int lowest = std::min(indices[3 * t], std::min(indices[3 * t + 1], indices[3 * t + 2]));
+        keys[t] = (uint64_t(lowest) << 32) | t;
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<unsigned int> byCorner;
+    byCorner.reserve(indices.size());
+    for (uint64_t key : keys) {
+        const unsigned int* corner = &indices[3 * static_cast<unsigned int>(key)];
+        byCorner.insert(byCorner.end(), corner, corner + 3);
+    }
+    indices.swap(byCorner);
+    optimizeTriangleOrder(indices, particles.size());
+}
+
+void Cloth::sortMeshConstraints() {
+    // By first particle, with the lower one first, like the grid's links. The
+    // coloring keeps this order within each bucket, so a sweep walks the
+    // particles forwards.
+    for (Constraint& c : constraints) {
+        if (c.p2 < c.p1) std::swap(c.p1, c.p2);
+    }
+    std::stable_sort(constraints.begin(), constraints.end(), [](const Constraint& a, const Constraint& b) {
+        return a.p1 < b.p1;
+    });
+}
+
+void Cloth::buildMeshConstraints(TaskPool* pool) {
+    // Every edge is owned by the lower numbered of its triangles (or its
+    // only one), found through the triangles around its first vertex. Links
+    // are counted per triangle, then written from the prefix sums.
+    const unsigned int NONE = ~0u;
+    const unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    auto across = [&](unsigned int t, unsigned int a, unsigned int b) {
+        const unsigned int* fan = vertexTriangles.data() + vertexTriangleOffsets[a];
+        for (unsigned int k = 0; k < vertexTriangleCounts[a]; k++) {
+            const unsigned int* corner = &indices[3 * fan[k]];
+            if (fan[k] != t && (corner[0] == b || corner[1] == b || corner[2] == b)) return fan[k];
+        }
+        return NONE;
+    };
+    auto links = [&](unsigned int t, auto&& emit) {
+        for (int e = 0; e < 3; e++) {
+            unsigned int a = indices[3 * t + e], b = indices[3 * t + (e + 1) % 3], c = indices[3 * t + (e + 2) % 3];
+            unsigned int u = across(t, a, b);
+            if (u < t) continue;
+            emit(a, b, params.structuralStiffness, STRUCTURAL);
+            if (u == NONE) continue;
+            const unsigned int* corner = &indices[3 * u];
+            unsigned int d = corner[0] != a && corner[0] != b ? corner[0] : corner[1] != a && corner[1] != b ? corner[1] : corner[2];
+            if (d != c) emit(c, d, params.bendingStiffness, BENDING);
+        }
+    };
+    auto forTriangles = [&](auto&& body) {
+        if (pool) pool->parallelFor(static_cast<int>(triangleCount), PARALLEL_GRAIN, body);
+        else body(0, static_cast<int>(triangleCount));
+    };
+
+    std::vector<unsigned int> firstLink(triangleCount + 1, 0);
+    forTriangles([&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            unsigned int count = 0;
+            links(t, [&](unsigned int, unsigned int, float, ConstraintType) { count++; });
+            firstLink[t + 1] = count;
+        }
+    });
+    for (unsigned int t = 0; t < triangleCount; t++) firstLink[t + 1] += firstLink[t];
+
+    constraints.assign(firstLink[triangleCount], Constraint(&particles[0], &particles[0], 0.0f, STRUCTURAL));
+    forTriangles([&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            unsigned int k = firstLink[t];
+            links(t, [&](unsigned int a, unsigned int b, float stiffness, ConstraintType type) {
+                constraints[k++] = Constraint(&particles[a], &particles[b], stiffness, type);
+            });
+        }
+    });
+}
+
+void Cloth::colorConstraints() {
+    // Greedy coloring: each constraint takes the lowest color neither of its
+    // particles has yet. Buckets are stored contiguously in color order. A
+    // grid needs about 20 colors; whatever finds all 64 taken shares one
+    // last bucket that is solved serially.
+    const int MAX_COLORS = 64;
+    const Particle* base = particles.data();
+    std::vector<uint64_t> used(particles.size(), 0);
+    std::vector<int> color(constraints.size());
+    int colorCount = 0;
+    parallelColorCount = 0;
+    for (size_t i = 0; i < constraints.size(); i++) {
+        size_t a = constraints[i].p1 - base, b = constraints[i].p2 - base;
+        uint64_t taken = used[a] | used[b];
+        int c = std::countr_one(taken);
+        if (c < MAX_COLORS) {
+            used[a] |= uint64_t(1) << c;
+            used[b] |= uint64_t(1) << c;
+            parallelColorCount = std::max(parallelColorCount, c + 1);
+        }
+        color[i] = c;
+        colorCount = std::max(colorCount, c + 1);
+    }
+
+    colorOffsets.assign(colorCount + 1, 0);
+    for (int c : color) colorOffsets[c + 1]++;
+    for (int c = 0; c < colorCount; c++) colorOffsets[c + 1] += colorOffsets[c];
+
+    std::vector<size_t> order(constraints.size());
+    std::vector<size_t> cursor(colorOffsets.begin(), colorOffsets.end() - 1);
+    for (size_t i = 0; i < constraints.size(); i++) order[cursor[color[i]]++] = i;
+
+    std::vector<Constraint> sorted;
+    sorted.reserve(constraints.size());
+    for (size_t i : order) sorted.push_back(constraints[i]);
+    constraints.swap(sorted);
+}
+
+void Cloth::integrate(size_t begin, size_t end, float dt, float damping, float stepRatio, glm::vec3 wind) {
+    // Still air has no direction to normalize, and pushes nothing
+    const bool windy = wind != glm::vec3(0.0f);
+    const glm::vec3 windDirection = windy ? glm::normalize(wind) : glm::vec3(0.0f);
+    for (size_t i = begin; i < end; i++) {
+        Particle& p = particles[i];
+
+        // A. Apply forces (Gravity + Wind)
+        if (!p.isPinned) {
+            p.addForce(glm::vec3(0.0f, -9.8f, 0.0f)); // 
+        }
+
+        // 
+        if (windy) {
+            glm::vec3 windForce = wind * (glm::dot(p.normal, windDirection) * 0.8f + 0.2f);
+            p.addForce(windForce);
+        }
+
+        // B. Integrate positions
+        p.update(dt, damping, stepRatio);
+    }
+}
+
+void Cloth::update(float dt, glm::vec3 wind, TaskPool* pool) {
+    // Small cloths are cheaper as one task than as many
+    if (pool && particles.size() < PARALLEL_MIN_PARTICLES) pool = nullptr;
+
+    // Steps may change length (AdaptiveStepper); at DAMPING_STEP with an
+    // unchanged dt both factors are exactly the fixed-step ones.
+    const float damping = std::pow(params.damping, dt / DAMPING_STEP);
+    const float stepRatio = lastStep > 0.0f ? dt / lastStep : 1.0f;
+    lastStep = dt;
+
+    // The state moves to the GPU with the compute solver, and back without
+    if (solver == SOLVER_COMPUTE && compute) {
+        if (!compute->resident) compute->upload(*this);
+        compute->step(*this, dt, damping, stepRatio, wind);
+        return;
+    }
+    if (onGpu()) {
+        compute->download(*this);
+        compute->resident = false;
+    }
+
+    // A + B. Forces and integration are independent per particle
+    if (pool) {
+        pool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end) {
+            integrate(begin, end, dt, damping, stepRatio, wind);
+        });
+    }
+    else {
+        integrate(0, particles.size(), dt, damping, stepRatio, wind);
+    }
+
+    // C. Satisfy constraints (PBD). The coarse levels only know the intact grid.
+    if (solver == SOLVER_MULTIGRID && isGrid()) {
+        if (!multigrid) multigrid = std::make_unique<ClothMultigrid>(*this, restPositions);
+        multigrid->solve(*this, MULTIGRID_CYCLES);
+    }
+    else if (pool) {
+        // Constraints of one color share no particle
+        for (int i = 0; i < params.constraintIterations; i++) {
+            for (size_t c = 0; c + 1 < colorOffsets.size(); c++) {
+                Constraint* bucket = constraints.data() + colorOffsets[c];
+                int count = static_cast<int>(colorOffsets[c + 1] - colorOffsets[c]);
+                if (static_cast<int>(c) >= parallelColorCount) {
+                    for (int k = 0; k < count; k++) bucket[k].solve();
+                    continue;
+                }
+                pool->parallelFor(count, PARALLEL_GRAIN, [bucket](int begin, int end) {
+                    for (int k = begin; k < end; k++) bucket[k].solve();
+                });
+            }
+        }
+    }
+    else {
+        for (int i = 0; i < params.constraintIterations; i++) {
+            for (auto& c : constraints) {
+                c.solve();
+            }
+        }
+    }
+
+    // D. Recalculate Normals and Tangents
+    recalculateNormals(pool);
+}
+
+void Cloth::recalculateNormals(TaskPool* pool) {
+    // Face normals first, then every vertex gathers its triangles in index
+    // order (the same sums a scatter over the triangles would produce, but
+    // without two threads writing one vertex). The bounds ride along, and
+    // particles that moved or turned flag their upload blocks.
+    const size_t tracked = uploadedPositions.size();
+    auto faces = [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const glm::vec3& p1 = particles[indices[3 * t]].position;
+            const glm::vec3& p2 = particles[indices[3 * t + 1]].position;
+            const glm::vec3& p3 = particles[indices[3 * t + 2]].position;
+
+            glm::vec3 edge1 = p2 - p1;
+            glm::vec3 edge2 = p3 - p1;
+            faceNormals[t] = glm::cross(edge1, edge2);
+            faceTangents[t] = glm::normalize(edge1); // ʹñ1Ϊ
+        }
+    };
+
+    auto vertices = [&](size_t begin, size_t end, glm::vec3& lo, glm::vec3& hi) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 normal(0.0f), tangent(0.0f);
+            const unsigned int end = vertexTriangleOffsets[i] + vertexTriangleCounts[i];
+            for (unsigned int k = vertexTriangleOffsets[i]; k < end; k++) {
+                normal += faceNormals[vertexTriangles[k]];
+                tangent += faceTangents[vertexTriangles[k]];
+            }
+
+            Particle& p = particles[i];
+            p.normal = glm::normalize(normal);
+            p.tangent = glm::normalize(tangent);
+            lo = glm::min(lo, p.position);
+            hi = glm::max(hi, p.position);
+
+            if (i < tracked && !dirtyBlocks[i / UPLOAD_BLOCK]) {
+                glm::vec3 d = p.position - uploadedPositions[i];
+                glm::vec3 n = p.normal - uploadedNormals[i];
+                glm::vec3 t = p.tangent - uploadedTangents[i];
+                if (glm::dot(d, d) > UPLOAD_EPSILON * UPLOAD_EPSILON
+                    || glm::dot(n, n) > UPLOAD_NORMAL_EPSILON * UPLOAD_NORMAL_EPSILON
+                    || glm::dot(t, t) > UPLOAD_NORMAL_EPSILON * UPLOAD_NORMAL_EPSILON) {
+                    dirtyBlocks[i / UPLOAD_BLOCK] = 1;
+                }
+            }
+        }
+    };
+
+    const size_t triangleCount = indices.size() / 3;
+    glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    if (!pool) {
+        faces(0, triangleCount);
+        vertices(0, particles.size(), lo, hi);
+    }
+    else {
+        pool->parallelFor(static_cast<int>(triangleCount), PARALLEL_GRAIN, [&](int begin, int end) {
+            faces(begin, end);
+        });
+
+        const size_t chunks = (particles.size() + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN;
+        if (chunkBounds.size() < chunks * 2) chunkBounds.resize(chunks * 2);
+        pool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end) {
+            glm::vec3* bounds = &chunkBounds[begin / PARALLEL_GRAIN * 2];
+            bounds[0] = glm::vec3(FLT_MAX);
+            bounds[1] = glm::vec3(-FLT_MAX);
+            vertices(begin, end, bounds[0], bounds[1]);
+        });
+        for (size_t c = 0; c < chunks; c++) {
+            lo = glm::min(lo, chunkBounds[2 * c]);
+            hi = glm::max(hi, chunkBounds[2 * c + 1]);
+        }
+    }
+    boundsMin = lo;
+    boundsMax = hi;
+}
+
+ClothMotion Cloth::measureMotion(TaskPool* pool) {
+    if (pool && particles.size() < PARALLEL_MIN_PARTICLES) pool = nullptr;
+    ClothMotion motion;
+    if (lastStep <= 0.0f) return motion;
+
+    // Squared distances while scanning, one square root per chunk
+    auto links = [&](size_t begin, size_t end, ClothMotion& m) {
+        float worst = 1.0f;
+        for (size_t k = begin; k < end; k++) {
+            const Constraint& c = constraints[k];
+            if (c.type != STRUCTURAL) continue;
+            glm::vec3 d = c.p2->position - c.p1->position;
+            float ratio = glm::dot(d, d) / (c.restDistance * c.restDistance);
+            if (!(ratio <= worst)) worst = ratio; // keeps a NaN from a blown-up step
+        }
+        float strain = std::sqrt(worst) - 1.0f;
+        if (!(strain <= m.maxStrain)) m.maxStrain = strain;
+    };
+    auto speeds = [&](size_t begin, size_t end, ClothMotion& m) {
+        float fastest = 0.0f;
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 d = particles[i].position - particles[i].oldPosition;
+            fastest = std::max(fastest, glm::dot(d, d));
+        }
+        m.maxSpeed = std::max(m.maxSpeed, std::sqrt(fastest) / lastStep);
+    };
+
+    if (!pool) {
+        links(0, constraints.size(), motion);
+        speeds(0, particles.size(), motion);
+        return motion;
+    }
+    const size_t linkChunks = (constraints.size() + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN;
+    const size_t particleChunks = (particles.size() + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN;
+    chunkMotion.assign(std::max(linkChunks, particleChunks), ClothMotion());
+    pool->parallelFor(static_cast<int>(constraints.size()), PARALLEL_GRAIN, [&](int begin, int end) {
+        links(begin, end, chunkMotion[begin / PARALLEL_GRAIN]);
+    });
+    pool->parallelFor(static_cast<int>(particles.size()), PARALLEL_GRAIN, [&](int begin, int end) {
+        speeds(begin, end, chunkMotion[begin / PARALLEL_GRAIN]);
+    });
+    for (const ClothMotion& m : chunkMotion) {
+        if (!(m.maxStrain <= motion.maxStrain)) motion.maxStrain = m.maxStrain;
+        motion.maxSpeed = std::max(motion.maxSpeed, m.maxSpeed);
+    }
+    return motion;
+}
+
+void Cloth::translate(glm::vec3 offset) {
+    for (auto& p : particles) {
+        p.position += offset;
+        p.oldPosition += offset;
+    }
+    boundsMin += offset;
+    boundsMax += offset;
+    std::fill(dirtyBlocks.begin(), dirtyBlocks.end(), 1);
+}
+
+bool Cloth::tear(int particleIndex) {
+    if (particleIndex < 0 || particleIndex >= static_cast<int>(particles.size()) || onGpu()) return false;
+    if (particleConstraints.empty()) buildConstraintAdjacency();
+
+    // Overstretched links at the grabbed particle and the crack tip. Either
+    // end may split, toward the other one; the most stretched link goes first.
+    // The grabbed particle itself splits last: that only drops the cloth.
+    struct Candidate {
+        unsigned int vertex;
+        glm::vec3 direction;
+        float strain;
+        unsigned int order;
+    };
+    ScratchScope scratch;
+    size_t capacity = particleConstraints[particleIndex].size();
+    for (unsigned int v : tearFront) capacity += particleConstraints[v].size();
+    Candidate* candidates = scratch.allocate<Candidate>(capacity * 2);
+    unsigned int count = 0;
+    auto consider = [&](unsigned int v) {
+        for (unsigned int i : particleConstraints[v]) {
+            const Constraint& c = constraints[i];
+            if (c.type == BENDING || c.restDistance == 0.0f) continue;
+            glm::vec3 delta = c.p2->position - c.p1->position;
+            float length = glm::length(delta);
+            float strain = length / c.restDistance - 1.0f;
+            if (strain <= params.tearStrain) continue;
+            unsigned int a = static_cast<unsigned int>(c.p1 - particles.data());
+            unsigned int b = static_cast<unsigned int>(c.p2 - particles.data());
+            candidates[count] = { a, delta / length, strain, count };
+            count++;
+            candidates[count] = { b, -delta / length, strain, count };
+            count++;
+        }
+    };
+    consider(particleIndex);
+    for (unsigned int v : tearFront) consider(v);
+
+    // Ties keep their order (std::stable_sort would take a heap buffer)
+    const unsigned int grabbed = static_cast<unsigned int>(particleIndex);
+    std::sort(candidates, candidates + count, [grabbed](const Candidate& a, const Candidate& b) {
+        if ((a.vertex == grabbed) != (b.vertex == grabbed)) return b.vertex == grabbed;
+        if (a.strain != b.strain) return a.strain > b.strain;
+        return a.order < b.order;
+    });
+    for (unsigned int i = 0; i < count; i++) {
+        if (splitVertex(candidates[i].vertex, candidates[i].direction)) return true;
+    }
+    return false;
+}
+
+void Cloth::buildConstraintAdjacency() {
+    // Also room for every spare particle, so no split reallocates these
+    const size_t spare = particles.capacity() - particles.size();
+    particleConstraints.reserve(particles.capacity());
+    vertexTriangleOffsets.reserve(particles.capacity());
+    vertexTriangleCounts.reserve(particles.capacity());
+    vertexTriangles.reserve(vertexTriangles.size() + spare * 6);
+    constraints.reserve(constraints.size() + spare * 2);
+
+    particleConstraints.assign(particles.size(), {});
+    for (size_t i = 0; i < constraints.size(); i++) {
+        particleConstraints[constraints[i].p1 - particles.data()].push_back(static_cast<unsigned int>(i));
+        particleConstraints[constraints[i].p2 - particles.data()].push_back(static_cast<unsigned int>(i));
+    }
+}
+
+size_t Cloth::colorOf(size_t constraint) const {
+    // Last bucket starting at or before it; empty buckets share that start
+    return std::upper_bound(colorOffsets.begin(), colorOffsets.end(), constraint) - colorOffsets.begin() - 1;
+}
+
+void Cloth::moveConstraint(size_t from, size_t to) {
+    if (from == to) return;
+    constraints[to] = constraints[from];
+    for (const Particle* p : { constraints[to].p1, constraints[to].p2 }) {
+        std::vector<unsigned int>& links = particleConstraints[p - particles.data()];
+        *std::find(links.begin(), links.end(), static_cast<unsigned int>(from)) = static_cast<unsigned int>(to);
+    }
+}
+
+void Cloth::removeConstraint(size_t i) {
+    for (const Particle* p : { constraints[i].p1, constraints[i].p2 }) {
+        std::vector<unsigned int>& links = particleConstraints[p - particles.data()];
+        *std::find(links.begin(), links.end(), static_cast<unsigned int>(i)) = links.back();
+        links.pop_back();
+    }
+
+    // The bucket's last constraint fills the hole; the freed slot becomes
+    // the next bucket's first, which its own last one fills, and so on.
+    size_t hole = i;
+    for (size_t c = colorOf(i); c + 1 < colorOffsets.size(); c++) {
+        size_t last = colorOffsets[c + 1] - 1;
+        moveConstraint(last, hole);
+        hole = last;
+        colorOffsets[c + 1]--;
+    }
+    constraints.pop_back();
+}
+
+void Cloth::insertConstraint(const Constraint& link) {
+    // Lowest color free at both ends; without one, the serial last bucket
+    const size_t a = link.p1 - particles.data(), b = link.p2 - particles.data();
+    uint64_t used = 0;
+    for (size_t v : { a, b }) {
+        for (unsigned int i : particleConstraints[v]) {
+            size_t c = colorOf(i);
+            if (c < 64) used |= uint64_t(1) << c;
+        }
+    }
+    size_t color = std::countr_one(used);
+    if (color >= static_cast<size_t>(parallelColorCount)) {
+        color = parallelColorCount;
+        if (colorOffsets.size() - 1 == color) colorOffsets.push_back(colorOffsets.back());
+    }
+
+    // Open a slot at the end and walk it up: each later bucket moves its
+    // first constraint into its slot past the end.
+    constraints.push_back(link);
+    size_t hole = constraints.size() - 1;
+    colorOffsets.back()++;
+    for (size_t c = colorOffsets.size() - 2; c > color; c--) {
+        size_t first = colorOffsets[c];
+        moveConstraint(first, hole);
+        hole = first;
+        colorOffsets[c]++;
+    }
+    constraints[hole] = link;
+    particleConstraints[a].push_back(static_cast<unsigned int>(hole));
+    particleConstraints[b].push_back(static_cast<unsigned int>(hole));
+}
+
+// Splits v by the plane through it facing direction. Triangles whose centre
+// lies in front move to a new vertex appended to the particles, along with
+// the links to particles in front. Ring vertices with triangles on both sides
+// lie on the crack: their edge link is duplicated for the new vertex and
+// they become the next tear candidates. Links between the two sides of the
+// ring (the bending and shear links across v) are cut.
+bool Cloth::splitVertex(unsigned int v, glm::vec3 direction) {
+    if (particles.size() == particles.capacity()) return false;
+
+    const glm::vec3 origin = particles[v].position;
+    auto inFront = [&](unsigned int t) {
+        glm::vec3 centre = particles[indices[3 * t]].position + particles[indices[3 * t + 1]].position + particles[indices[3 * t + 2]].position;
+        return glm::dot(centre / 3.0f - origin, direction) > 0.0f;
+    };
+    unsigned int* fan = vertexTriangles.data() + vertexTriangleOffsets[v];
+    const unsigned int fanSize = vertexTriangleCounts[v];
+    const unsigned int kept = static_cast<unsigned int>(std::count_if(fan, fan + fanSize, [&](unsigned int t) { return !inFront(t); }));
+    if (kept == 0 || kept == fanSize) return false;
+
+    // Ring sides: 1 behind, 2 in front, 3 on the crack
+    ScratchScope scratch;
+    std::pair<unsigned int, int>* ring = scratch.allocate<std::pair<unsigned int, int>>(fanSize * 2);
+    std::pair<unsigned int, int>* ringEnd = ring;
+    for (unsigned int k = 0; k < fanSize; k++) {
+        const int side = inFront(fan[k]) ? 2 : 1;
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int u = indices[3 * fan[k] + corner];
+            if (u == v) continue;
+            auto it = std::find_if(ring, ringEnd, [u](const auto& r) { return r.first == u; });
+            if (it == ringEnd) *ringEnd++ = { u, side };
+            else it->second |= side;
+        }
+    }
+    auto sideOf = [&](unsigned int u) {
+        for (auto r = ring; r != ringEnd; ++r) {
+            if (r->first == u) return r->second;
+        }
+        return glm::dot(particles[u].position - origin, direction) > 0.0f ? 2 : 1;
+    };
+
+    // The copy is free: a tear pulls cloth off its pin
+    const unsigned int split = static_cast<unsigned int>(particles.size());
+    Particle copy = particles[v];
+    copy.isPinned = false;
+    particles.push_back(copy);
+    particleConstraints.emplace_back();
+
+    // Front triangles move to the new vertex, the rest stay in index order
+    unsigned int* moved = scratch.allocate<unsigned int>(fanSize - kept);
+    unsigned int movedCount = 0, keptCount = 0;
+    for (unsigned int k = 0; k < fanSize; k++) {
+        if (inFront(fan[k])) moved[movedCount++] = fan[k];
+        else fan[keptCount++] = fan[k];
+    }
+    std::copy(moved, moved + movedCount, fan + kept);
+    vertexTriangleCounts[v] = kept;
+    // v keeps its place but loses triangles, so its normal changes
+    if (v / UPLOAD_BLOCK < dirtyBlocks.size()) dirtyBlocks[v / UPLOAD_BLOCK] = 1;
+    vertexTriangleOffsets.push_back(static_cast<unsigned int>(vertexTriangles.size()));
+    vertexTriangleCounts.push_back(movedCount);
+    for (unsigned int i = 0; i < movedCount; i++) {
+        const unsigned int t = moved[i];
+        for (int corner = 0; corner < 3; corner++) {
+            if (indices[3 * t + corner] == v) indices[3 * t + corner] = split;
+        }
+        vertexTriangles.push_back(t);
+        dirtyTriangles.push_back(t);
+    }
+
+    // Links of v: in front move over, those along the crack are duplicated
+    // once the retargeting is done, since inserting moves constraints
+    std::vector<unsigned int>& own = particleConstraints[v];
+    Constraint* duplicates = scratch.allocate<Constraint>(own.size());
+    size_t duplicateCount = 0;
+    for (size_t k = 0; k < own.size();) {
+        Constraint& c = constraints[own[k]];
+        Particle*& self = c.p1 == &particles[v] ? c.p1 : c.p2;
+        const Particle* other = c.p1 == &particles[v] ? c.p2 : c.p1;
+        const int side = sideOf(static_cast<unsigned int>(other - particles.data()));
+        if (side == 3) {
+            Constraint& link = duplicates[duplicateCount++] = c;
+            (link.p1 == &particles[v] ? link.p1 : link.p2) = &particles[split];
+        }
+        if (side != 2) {
+            k++;
+            continue;
+        }
+        self = &particles[split];
+        particleConstraints[split].push_back(own[k]);
+        own[k] = own.back();
+        own.pop_back();
+    }
+    for (size_t i = 0; i < duplicateCount; i++) insertConstraint(duplicates[i]);
+
+    // Links from one side of the ring to the other would bridge the crack
+    bool cut = true;
+    while (cut) {
+        cut = false;
+        for (auto r = ring; r != ringEnd; ++r) {
+            if (r->second != 1) continue;
+            for (unsigned int i : particleConstraints[r->first]) {
+                const Constraint& c = constraints[i];
+                const unsigned int u = static_cast<unsigned int>((c.p1 == &particles[r->first] ? c.p2 : c.p1) - particles.data());
+                auto other = std::find_if(ring, ringEnd, [u](const auto& q) { return q.first == u; });
+                if (other != ringEnd && other->second == 2) {
+                    removeConstraint(i);
+                    cut = true;
+                    break;
+                }
+            }
+            if (cut) break;
+        }
+    }
+
+    tearFront.clear();
+    for (auto r = ring; r != ringEnd; ++r) {
+        if (r->second == 3) tearFront.push_back(r->first);
+    }
+    tearFront.push_back(v);
+    tearFront.push_back(split);
+    return true;
+}
+
+void Cloth::setupMesh() {
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // Each vertex: Pos(3) + Norm(3) + Tex(2) + Tan(3) = 11 floats. Room for
+    // the spare tearing slots, so splits never reallocate it.
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(particles.capacity() * 11 * sizeof(float)), NULL, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), GL_STATIC_DRAW);
+    dirtyTriangles.clear();
+    uploadedPositions.reserve(particles.capacity());
+    uploadedNormals.reserve(particles.capacity());
+    uploadedTangents.reserve(particles.capacity());
+    dirtyBlocks.reserve((particles.capacity() + UPLOAD_BLOCK - 1) / UPLOAD_BLOCK);
+
+    size_t stride = 11 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(8 * sizeof(float)));
+
+    glBindVertexArray(0);
+}
+
+void Cloth::uploadVertices(bool all) {
+    if (!VAO) setupMesh();
+
+    // Particles never uploaded are dirty
+    const size_t blocks = (particles.size() + UPLOAD_BLOCK - 1) / UPLOAD_BLOCK;
+    if (uploadedPositions.size() < particles.size()) {
+        const size_t firstNew = uploadedPositions.size() / UPLOAD_BLOCK;
+        uploadedPositions.resize(particles.size());
+        uploadedNormals.resize(particles.size());
+        uploadedTangents.resize(particles.size());
+        dirtyBlocks.resize(blocks);
+        std::fill(dirtyBlocks.begin() + firstNew, dirtyBlocks.end(), 1);
+    }
+    if (all) std::fill(dirtyBlocks.begin(), dirtyBlocks.end(), 1);
+
+    // Update VBO data, packed in frame scratch, one run of dirty blocks at a time
+    ScratchScope scratch;
+    float* data = scratch.allocate<float>(particles.size() * 11);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    for (size_t b = 0; b < blocks;) {
+        if (!dirtyBlocks[b]) {
+            b++;
+            continue;
+        }
+        size_t end = b + 1;
+        while (end < blocks && dirtyBlocks[end]) end++;
+        std::fill(dirtyBlocks.begin() + b, dirtyBlocks.begin() + end, 0);
+
+        const size_t first = b * UPLOAD_BLOCK, last = std::min(end * UPLOAD_BLOCK, particles.size());
+        packVertices(first, last, data);
+        for (size_t i = first; i < last; i++) {
+            uploadedPositions[i] = particles[i].position;
+            uploadedNormals[i] = particles[i].normal;
+            uploadedTangents[i] = particles[i].tangent;
+        }
+        const size_t bytes = (last - first) * 11 * sizeof(float);
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first * 11 * sizeof(float)), static_cast<GLsizeiptr>(bytes), data);
+        uploadedBytes += bytes;
+        b = end;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!dirtyTriangles.empty()) uploadDirtyTriangles();
+}
+
+void Cloth::packVertices(size_t first, size_t last, float* out) const {
+    for (size_t i = first; i < last; i++) {
+        const Particle& p = particles[i];
+        *out++ = p.position.x; *out++ = p.position.y; *out++ = p.position.z;
+        *out++ = p.normal.x;   *out++ = p.normal.y;   *out++ = p.normal.z;
+        *out++ = p.uv.x;       *out++ = p.uv.y;
+        *out++ = p.tangent.x;  *out++ = p.tangent.y;  *out++ = p.tangent.z;
+    }
+}
+
+void Cloth::uploadDirtyTriangles() {
+    // One sub-upload per run of consecutive triangles
+    std::sort(dirtyTriangles.begin(), dirtyTriangles.end());
+    dirtyTriangles.erase(std::unique(dirtyTriangles.begin(), dirtyTriangles.end()), dirtyTriangles.end());
+
+    glBindVertexArray(VAO);
+    for (size_t i = 0; i < dirtyTriangles.size();) {
+        size_t run = 1;
+        while (i + run < dirtyTriangles.size() && dirtyTriangles[i + run] == dirtyTriangles[i] + run) run++;
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLintptr>(dirtyTriangles[i] * 3 * sizeof(unsigned int)),
+            static_cast<GLsizeiptr>(run * 3 * sizeof(unsigned int)), &indices[dirtyTriangles[i] * 3]);
+        i += run;
+    }
+    glBindVertexArray(0);
+    dirtyTriangles.clear();
+}
+
+bool Cloth::onGpu() const {
+    return compute && compute->resident;
+}
+
+void Cloth::fetchFromGpu() {
+    if (onGpu()) compute->download(*this);
+}
+
+void Cloth::particleChanged(size_t i) {
+    if (onGpu()) compute->writeParticle(*this, i);
+}
+
+void Cloth::draw(unsigned int shaderProgram, RenderMode mode) {
+    if (onGpu()) {
+        compute->draw(mode);
+        return;
+    }
+    uploadVertices();
+    glBindVertexArray(VAO);
+
+    // Draw based on mode
+    if (mode == POINTS) {
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(particles.size()));
+    }
+    else {
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ClothCompute;
+class ClothMultigrid;
+class TaskPool;
+
+const float DAMPING = 0.98f;
+// Damping is the velocity kept over a step of this length; other step
+// lengths are damped to lose the same per second.
+const float DAMPING_STEP = 0.01f;
+const int CONSTRAINT_ITERATIONS = 5;
+// V-cycles per step in multigrid mode, about the cost of the sweeps above
+const int MULTIGRID_CYCLES = 2;
+
+// Cloths from this size up split their update into pool sub-tasks
+const size_t PARALLEL_MIN_PARTICLES = 8192;
+const int PARALLEL_GRAIN = 1024;
+
+// Silk physical parameters
+const float STRUCTURAL_STIFFNESS = 1.0f;
+const float SHEAR_STIFFNESS = 0.8f;
+const float BENDING_STIFFNESS = 0.05f;
+
+// Structural and shear links tear past this strain (0.6 = 160% of rest length)
+const float TEAR_STRAIN = 0.6f;
+// Spare particle slots for tearing, one per this many particles. Splits
+// append into them, so the constraints' particle pointers never move.
+const size_t TEAR_SPARE_DIVISOR = 4;
+
+// Vertex uploads go by blocks of this many particles, and skip a block
+// while all its particles are within UPLOAD_EPSILON of the positions last
+// uploaded (a hundredth of the grid spacing, under a pixel at the usual
+// viewing distance) and their normals and tangents within
+// UPLOAD_NORMAL_EPSILON of the uploaded ones (about half a degree; a
+// neighbour moving turns a still particle's normal). A divisor of
+// PARALLEL_GRAIN, so a parallel chunk owns its blocks.
+const size_t UPLOAD_BLOCK = 64;
+const float UPLOAD_EPSILON = 1e-3f;
+const float UPLOAD_NORMAL_EPSILON = 1e-2f;
+
+// Tunable physics parameters; defaults are the constants above
+struct ClothParams {
+    float damping = DAMPING;
+    int constraintIterations = CONSTRAINT_ITERATIONS;
+    float structuralStiffness = STRUCTURAL_STIFFNESS;
+    float shearStiffness = SHEAR_STIFFNESS;
+    float bendingStiffness = BENDING_STIFFNESS;
+    float tearStrain = TEAR_STRAIN;
+    // Meshes only: sort particles and triangles for locality (MeshOrder.h)
+    bool reorderMesh = true;
+};
+
+enum RenderMode { SHADED, WIREFRAME, POINTS };
+
+enum ConstraintType { STRUCTURAL, SHEAR, BENDING };
+
+// SOLVER_COMPUTE runs whole steps in compute shaders (ClothCompute.h)
+enum SolverMode { SOLVER_GAUSS_SEIDEL, SOLVER_MULTIGRID, SOLVER_COMPUTE };
+
+// ==========================================
+// Physics Structure
+// ==========================================
+struct Particle {
+    glm::vec3 position;
+    glm::vec3 oldPosition;
+    glm::vec3 acceleration;
+    glm::vec2 uv;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    bool isPinned;
+    float mass;
+
+    Particle(glm::vec3 pos, glm::vec2 tex) :
+        position(pos), oldPosition(pos), acceleration(0.0f),
+        uv(tex), normal(0.0f, 0.0f, 1.0f), tangent(1.0f, 0.0f, 0.0f),
+        isPinned(false), mass(1.0f) {
+    }
+
+    void addForce(glm::vec3 f) {
+        acceleration += f / mass;
+    }
+
+    // stepRatio is dt over the previous step: the position difference
+    // carries the velocity of that step, so it is rescaled to this one.
+    void update(float dt, float damping = DAMPING, float stepRatio = 1.0f) {
+        if (isPinned) return;
+
+        glm::vec3 velocity = (position - oldPosition) * stepRatio;
+        oldPosition = position;
+        // ʹ std::clamp ٶȣֹӷߣȶ
+        float velocityMag = glm::length(velocity);
+        if (velocityMag > 10.0f) { // ٶ
+            velocity = glm::normalize(velocity) * 10.0f;
+        }
+
+        position += velocity * damping + acceleration * dt * dt;
+        acceleration = glm::vec3(0.0f);
+    }
+};
+
+struct Constraint {
+    Particle* p1;
+    Particle* p2;
+    float restDistance;
+    float stiffness;
+    ConstraintType type;
+
+    Constraint(Particle* pi, Particle* pj, float stiff, ConstraintType t) : p1(pi), p2(pj), stiffness(stiff), type(t) {
+        restDistance = glm::distance(p1->position, p2->position);
+    }
+
+    void solve() {
+        glm::vec3 delta = p2->position - p1->position;
+        float currentDist = glm::length(delta);
+        if (currentDist == 0.0f) return;
+
+        // PBD Լ
+        float correctionAmount = (currentDist - restDistance) / currentDist;
+        glm::vec3 correction = delta * correctionAmount * 0.5f * stiffness;
+
+        if (!p1->isPinned) p1->position += correction;
+        if (!p2->isPinned) p2->position -= correction;
+    }
+};
+
+// How hard a cloth is moving after a step, for choosing the next one
+struct ClothMotion {
+    float maxStrain = 0.0f; // largest structural stretch, (length - rest) / rest
+    float maxSpeed = 0.0f;  // fastest particle over the last step, units per second
+};
+
+// ==========================================
+// Cloth Class
+// ==========================================
+class Cloth {
+public:
+    int width, height;
+    std::vector<Particle> particles;
+    std::vector<Constraint> constraints;
+    std::vector<unsigned int> indices;
+
+    // constraints are grouped by color: [colorOffsets[c], colorOffsets[c + 1])
+    // share no particle for c < parallelColorCount
+    std::vector<size_t> colorOffsets;
+    int parallelColorCount = 0;
+
+    // Triangles around each vertex: vertexTriangleCounts[i] entries of
+    // vertexTriangles from vertexTriangleOffsets[i]
+    std::vector<unsigned int> vertexTriangleOffsets;
+    std::vector<unsigned int> vertexTriangleCounts;
+    std::vector<unsigned int> vertexTriangles;
+
+    // World-space bounds, refreshed with the normals
+    glm::vec3 boundsMin, boundsMax;
+
+    ClothParams params;
+
+    // Created on first upload, so a cloth can be simulated without a context
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    // Vertex bytes sent by uploadVertices so far, for profiling
+    uint64_t uploadedBytes = 0;
+
+    SolverMode solver = SOLVER_GAUSS_SEIDEL;
+    // Built on the first multigrid step, from restPositions
+    std::unique_ptr<ClothMultigrid> multigrid;
+    // Set by the app when the context has compute shaders
+    std::unique_ptr<ClothCompute> compute;
+
+    Cloth(int w, int h, const ClothParams& clothParams = ClothParams());
+    // Builds the grid over already laid out particles (row-major, w * h),
+    // e.g. a subsampled copy of a finer cloth.
+    Cloth(int w, int h, std::vector<Particle> gridParticles, const ClothParams& clothParams = ClothParams());
+    // A triangle mesh, e.g. an imported garment: a structural link along
+    // every edge and a bending link across every inner edge, between the
+    // corners opposite it. width and height are 0. Particles and triangles
+    // are renumbered along a space-filling curve first, unless
+    // params.reorderMesh is off. With a pool the links are generated in
+    // parallel.
+    Cloth(std::vector<Particle> meshParticles, std::vector<unsigned int> triangles, const ClothParams& clothParams = ClothParams(), TaskPool* pool = nullptr);
+    // Constraints hold pointers into particles, so a cloth is never copied.
+    Cloth(const Cloth&) = delete;
+    Cloth& operator=(const Cloth&) = delete;
+    ~Cloth();
+
+    // With a pool, large cloths run each phase as parallel sub-tasks.
+    void update(float dt, glm::vec3 wind, TaskPool* pool = nullptr);
+    // Forces and integration of particles [begin, end), update's first phase
+    void integrate(size_t begin, size_t end, float dt, float damping, float stepRatio, glm::vec3 wind);
+    void recalculateNormals(TaskPool* pool = nullptr);
+    // Strain and speed as the last update() left them (see AdaptiveStepper.h)
+    ClothMotion measureMotion(TaskPool* pool = nullptr);
+    // dt of the last update (0 before the first). The next update rescales
+    // the Verlet velocity by its own dt over this, so state copied in from
+    // another cloth (a LOD switch) brings its step length along.
+    float lastStepLength() const { return lastStep; }
+    void setLastStepLength(float dt) { lastStep = dt; }
+    // Moves the whole cloth, e.g. to place it in a scene.
+    void translate(glm::vec3 offset);
+    // Splits one vertex at particleIndex, or at the tip of an earlier tear,
+    // whose structural or shear links are stretched past params.tearStrain.
+    // Costs as much as the torn region, not the cloth. Returns true on a split.
+    // Not while the state is on the GPU.
+    bool tear(int particleIndex);
+    // The state lives in compute's buffers, and particles is stale.
+    bool onGpu() const;
+    // Copies the GPU state into particles, e.g. to pick from it.
+    void fetchFromGpu();
+    // Writes an edit of particles[i] (a drag, a pin) to the GPU state.
+    void particleChanged(size_t i);
+    // The particles are exactly the width * height grid: not a mesh, and
+    // not torn (split vertices are appended past it). LOD, multigrid and
+    // surface detail all need the grid.
+    bool isGrid() const { return !particles.empty() && particles.size() == static_cast<size_t>(width) * height; }
+    void setupMesh();
+    // Packs particles into the VBO (11 floats per vertex): the blocks whose
+    // particles moved since the last upload, merged into runs, one
+    // glBufferSubData each. all sends every particle, e.g. to copy the VBO.
+    void uploadVertices(bool all = false);
+    // The VBO layout of particles [first, last), 11 floats each
+    void packVertices(size_t first, size_t last, float* out) const;
+    void draw(unsigned int shaderProgram, RenderMode mode);
+
+private:
+    // Constraints, triangle indices and GL buffers for the particle grid.
+    void buildTopology();
+    void reorderMesh();
+    void buildMeshConstraints(TaskPool* pool);
+    void sortMeshConstraints();
+    void buildVertexTriangles();
+    void colorConstraints();
+
+    // Tearing. Constraint buckets stay contiguous: a removal swap-removes in
+    // its bucket and passes the hole down the later ones, an insertion the
+    // other way, so both cost one move per color.
+    void buildConstraintAdjacency();
+    size_t colorOf(size_t constraint) const;
+    void moveConstraint(size_t from, size_t to);
+    void removeConstraint(size_t i);
+    void insertConstraint(const Constraint& link);
+    bool splitVertex(unsigned int v, glm::vec3 direction);
+    void uploadDirtyTriangles();
+
+    std::vector<std::vector<unsigned int>> particleConstraints; // built on the first tear
+    std::vector<unsigned int> tearFront;      // vertices at the tip of the last split
+    std::vector<unsigned int> dirtyTriangles; // reindexed since the last upload
+
+    // Dirty blocks for uploadVertices, flagged by recalculateNormals, the
+    // last pass of a step, when a particle's position, normal or tangent
+    // has moved past its epsilon from the uploaded one. Particles past
+    // uploadedPositions (before the first upload, split by a tear) have
+    // never been uploaded.
+    std::vector<glm::vec3> uploadedPositions, uploadedNormals, uploadedTangents;
+    std::vector<unsigned char> dirtyBlocks;
+
+    std::vector<glm::vec3> faceNormals, faceTangents;
+    std::vector<glm::vec3> restPositions; // grids only, for the multigrid levels
+    std::vector<glm::vec3> chunkBounds; // per-chunk (min, max) for the parallel path
+    std::vector<ClothMotion> chunkMotion;
+    float lastStep = 0.0f; // dt of the last update, 0 before the first
+};
@@ -0,0 +1,301 @@
+#include "ClothCompute.h"
+#include "FrameMemory.h"
+#include "ShaderManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// One table for the four programs; a program without a uniform gets -1,
+// which glUniform ignores. Order must match COMPUTE_UNIFORM_NAMES.
+enum ComputeUniform { C_COUNT, C_DT, C_DAMPING, C_STEP_RATIO, C_WIND, C_FIRST, C_SERIAL };
+const std::vector<const char*> COMPUTE_UNIFORM_NAMES = {
+    "count", "dt", "damping", "stepRatio", "wind", "first", "serial"
+};
+
+const unsigned int WORKGROUP_SIZE = 64; // local_size_x of the shaders
+
+// Storage buffer bindings, as declared in shaders/cloth_*.comp
+enum ComputeBinding {
+    B_VERTICES, B_STATE, B_LINKS, B_INDICES, B_FACES, B_FANS, B_FAN_TRIANGLES, B_BOUNDS
+};
+
+// Matches struct Link in cloth_constraints.comp
+struct GpuLink {
+    unsigned int p1, p2;
+    float restDistance, stiffness;
+};
+
+GLuint groups(size_t count) {
+    return static_cast<GLuint>((count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE);
+}
+
+// Inverse of orderedBits in cloth_vertices.comp
+float orderedFloat(unsigned int u) {
+    u = (u & 0x80000000u) ? u & 0x7fffffffu : ~u;
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+} // namespace
+
+bool ComputePrograms::load(ShaderManager& manager) {
+    shaders = &manager;
+    integrate = manager.addProgram("cloth_integrate", { { GL_COMPUTE_SHADER, "cloth_integrate.comp" } }, COMPUTE_UNIFORM_NAMES);
+    constraints = manager.addProgram("cloth_constraints", { { GL_COMPUTE_SHADER, "cloth_constraints.comp" } }, COMPUTE_UNIFORM_NAMES);
+    faces = manager.addProgram("cloth_faces", { { GL_COMPUTE_SHADER, "cloth_faces.comp" } }, COMPUTE_UNIFORM_NAMES);
+    vertices = manager.addProgram("cloth_vertices", { { GL_COMPUTE_SHADER, "cloth_vertices.comp" } }, COMPUTE_UNIFORM_NAMES);
+    if (integrate < 0 || constraints < 0 || faces < 0 || vertices < 0) {
+        std::cout << "Failed to load compute solver programs" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ClothCompute::ClothCompute(const ComputePrograms& computePrograms) : programs(computePrograms) {
+}
+
+ClothCompute::~ClothCompute() {
+    release();
+}
+
+bool ClothCompute::supported() {
+    return GLEW_VERSION_4_3;
+}
+
+void ClothCompute::release() {
+    for (int s = 0; s < BOUNDS_RING; s++) {
+        if (boundsFences[s]) glDeleteSync(boundsFences[s]);
+        boundsFences[s] = 0;
+    }
+    if (VAO) {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &stateBuffer);
+        glDeleteBuffers(1, &linkBuffer);
+        glDeleteBuffers(1, &faceBuffer);
+        glDeleteBuffers(1, &fanBuffer);
+        glDeleteBuffers(1, &fanTriangleBuffer);
+        glDeleteBuffers(BOUNDS_RING, boundsBuffers);
+    }
+    VAO = vertexBuffer = stateBuffer = linkBuffer = 0;
+    faceBuffer = fanBuffer = fanTriangleBuffer = 0;
+    std::fill(boundsBuffers, boundsBuffers + BOUNDS_RING, 0u);
+    resident = false;
+}
+
+void ClothCompute::upload(Cloth& cloth) {
+    // Packs the vertices (and flushes torn triangles) into the cloth's own
+    // buffers: the vertex data is copied from there, and the index buffer
+    // is shared with the face pass.
+    cloth.uploadVertices(true);
+
+    if (!VAO) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &stateBuffer);
+        glGenBuffers(1, &linkBuffer);
+        glGenBuffers(1, &faceBuffer);
+        glGenBuffers(1, &fanBuffer);
+        glGenBuffers(1, &fanTriangleBuffer);
+        glGenBuffers(BOUNDS_RING, boundsBuffers);
+        for (int s = 0; s < BOUNDS_RING; s++) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffers[s]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, 6 * sizeof(unsigned int), NULL, GL_DYNAMIC_READ);
+        }
+    }
+    for (int s = 0; s < BOUNDS_RING; s++) {
+        if (boundsFences[s]) glDeleteSync(boundsFences[s]);
+        boundsFences[s] = 0;
+    }
+
+    particleCount = cloth.particles.size();
+    triangleCount = cloth.indices.size() / 3;
+    const Particle* base = cloth.particles.data();
+
+    const GLsizeiptr vertexBytes = static_cast<GLsizeiptr>(particleCount * 11 * sizeof(float));
+    glBindBuffer(GL_COPY_READ_BUFFER, cloth.VBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexBytes, NULL, GL_DYNAMIC_COPY);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    ScratchScope scratch;
+    glm::vec4* state = scratch.allocate<glm::vec4>(particleCount);
+    for (size_t i = 0; i < particleCount; i++) {
+        state[i] = glm::vec4(base[i].oldPosition, base[i].isPinned ? 1.0f : 0.0f);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(particleCount * sizeof(glm::vec4)), state, GL_DYNAMIC_COPY);
+
+    // Constraints keep their color order, so a color is a range of links
+    GpuLink* links = scratch.allocate<GpuLink>(std::max<size_t>(cloth.constraints.size(), 1));
+    for (size_t k = 0; k < cloth.constraints.size(); k++) {
+        const Constraint& c = cloth.constraints[k];
+        links[k] = { static_cast<unsigned int>(c.p1 - base), static_cast<unsigned int>(c.p2 - base), c.restDistance, c.stiffness };
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, linkBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(std::max<size_t>(cloth.constraints.size(), 1) * sizeof(GpuLink)), links, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, faceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(std::max<size_t>(triangleCount, 1) * 2 * sizeof(glm::vec4)), NULL, GL_DYNAMIC_COPY);
+
+    unsigned int* fans = scratch.allocate<unsigned int>(particleCount * 2);
+    for (size_t i = 0; i < particleCount; i++) {
+        fans[2 * i] = cloth.vertexTriangleOffsets[i];
+        fans[2 * i + 1] = cloth.vertexTriangleCounts[i];
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, fanBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(particleCount * 2 * sizeof(unsigned int)), fans, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, fanTriangleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(std::max<size_t>(cloth.vertexTriangles.size(), 1) * sizeof(unsigned int)),
+        cloth.vertexTriangles.empty() ? NULL : cloth.vertexTriangles.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The storage buffer is the vertex buffer: same layout as Cloth::setupMesh
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cloth.EBO);
+    size_t stride = 11 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(stride), (void*)(8 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    resident = true;
+}
+
+void ClothCompute::download(Cloth& cloth) {
+    const size_t count = std::min(particleCount, cloth.particles.size());
+    ScratchScope scratch;
+    float* vertices = scratch.allocate<float>(count * 11);
+    glm::vec4* state = scratch.allocate<glm::vec4>(count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(count * 11 * sizeof(float)), vertices);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(count * sizeof(glm::vec4)), state);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    const float* in = vertices;
+    for (size_t i = 0; i < count; i++, in += 11) {
+        Particle& p = cloth.particles[i];
+        p.position = glm::vec3(in[0], in[1], in[2]);
+        p.normal = glm::vec3(in[3], in[4], in[5]);
+        p.tangent = glm::vec3(in[8], in[9], in[10]);
+        p.oldPosition = glm::vec3(state[i].x, state[i].y, state[i].z);
+    }
+}
+
+void ClothCompute::writeParticle(const Cloth& cloth, size_t index) {
+    if (index >= particleCount) return;
+    const Particle& p = cloth.particles[index];
+    glm::vec4 state(p.oldPosition, p.isPinned ? 1.0f : 0.0f);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(index * 11 * sizeof(float)), 3 * sizeof(float), &p.position);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(index * sizeof(glm::vec4)), sizeof(glm::vec4), &state);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ClothCompute::readBounds(Cloth& cloth) {
+    // Oldest first from the slot the next step overwrites; that one is
+    // waited for if it has to be, the rest only taken once finished.
+    for (int k = 0; k < BOUNDS_RING; k++) {
+        const int s = (boundsSlot + k) % BOUNDS_RING;
+        if (!boundsFences[s]) continue;
+        GLenum status = k == 0
+            ? glClientWaitSync(boundsFences[s], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED)
+            : glClientWaitSync(boundsFences[s], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) break; // later steps are not done either
+        glDeleteSync(boundsFences[s]);
+        boundsFences[s] = 0;
+
+        unsigned int bounds[6];
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffers[s]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(bounds), bounds);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        cloth.boundsMin = glm::vec3(orderedFloat(bounds[0]), orderedFloat(bounds[1]), orderedFloat(bounds[2]));
+        cloth.boundsMax = glm::vec3(orderedFloat(bounds[3]), orderedFloat(bounds[4]), orderedFloat(bounds[5]));
+    }
+}
+
+void ClothCompute::step(Cloth& cloth, float dt, float damping, float stepRatio, glm::vec3 wind) {
+    readBounds(cloth);
+    const ShaderManager& shaders = *programs.shaders;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_VERTICES, vertexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_STATE, stateBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_LINKS, linkBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_INDICES, cloth.EBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_FACES, faceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_FANS, fanBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_FAN_TRIANGLES, fanTriangleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, B_BOUNDS, boundsBuffers[boundsSlot]);
+
+    // A + B. Forces and integration; also empties the bounds
+    int h = programs.integrate;
+    glUseProgram(shaders.program(h));
+    glUniform1ui(shaders.uniform(h, C_COUNT), static_cast<GLuint>(particleCount));
+    glUniform1f(shaders.uniform(h, C_DT), dt);
+    glUniform1f(shaders.uniform(h, C_DAMPING), damping);
+    glUniform1f(shaders.uniform(h, C_STEP_RATIO), stepRatio);
+    glUniform3f(shaders.uniform(h, C_WIND), wind.x, wind.y, wind.z);
+    glDispatchCompute(std::max<GLuint>(groups(particleCount), 1), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // C. Constraints, color by color: each dispatch sees the one before
+    h = programs.constraints;
+    glUseProgram(shaders.program(h));
+    for (int i = 0; i < cloth.params.constraintIterations; i++) {
+        for (size_t c = 0; c + 1 < cloth.colorOffsets.size(); c++) {
+            const size_t count = cloth.colorOffsets[c + 1] - cloth.colorOffsets[c];
+            if (count == 0) continue;
+            const bool serial = static_cast<int>(c) >= cloth.parallelColorCount;
+            glUniform1ui(shaders.uniform(h, C_FIRST), static_cast<GLuint>(cloth.colorOffsets[c]));
+            glUniform1ui(shaders.uniform(h, C_COUNT), static_cast<GLuint>(count));
+            glUniform1i(shaders.uniform(h, C_SERIAL), serial);
+            glDispatchCompute(serial ? 1 : groups(count), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+    }
+
+    // D. Normals and tangents, faces first
+    if (triangleCount > 0) {
+        h = programs.faces;
+        glUseProgram(shaders.program(h));
+        glUniform1ui(shaders.uniform(h, C_COUNT), static_cast<GLuint>(triangleCount));
+        glDispatchCompute(groups(triangleCount), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    h = programs.vertices;
+    glUseProgram(shaders.program(h));
+    glUniform1ui(shaders.uniform(h, C_COUNT), static_cast<GLuint>(particleCount));
+    glDispatchCompute(std::max<GLuint>(groups(particleCount), 1), 1, 1);
+
+    // Drawn from next, and read back (bounds, fetches) with glGetBufferSubData
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    boundsFences[boundsSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    boundsSlot = (boundsSlot + 1) % BOUNDS_RING;
+    glUseProgram(0);
+}
+
+void ClothCompute::draw(RenderMode mode) {
+    glBindVertexArray(VAO);
+    if (mode == POINTS) {
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(particleCount));
+    }
+    else {
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(triangleCount * 3), GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Cloth.h"
+
+#include <GL/glew.h>
+
+class ShaderManager;
+
+// ==========================================
+// Compute Shader Solver (GL 4.3)
+// ==========================================
+// Runs Cloth::update on the GPU: the particles live in shader storage
+// buffers and every phase is a compute dispatch.
+//   shaders/cloth_integrate.comp   - forces and Verlet integration
+//   shaders/cloth_constraints.comp - one dispatch per color per iteration,
+//                                    in the order colorConstraints left them
+//   shaders/cloth_faces.comp       - face normals and tangents
+//   shaders/cloth_vertices.comp    - vertex normals, tangents and bounds
+// The vertex buffer has the 11-float layout Cloth::setupMesh uses, so it is
+// bound as the vertex array's GL_ARRAY_BUFFER and nothing is uploaded per
+// frame. The bounds for culling come back through a small ring of buffers
+// read a few steps late, so stepping never waits for the GPU.
+//
+// While a cloth's state is on the GPU (Cloth::onGpu), cloth.particles is
+// stale. Anything that reads it must fetch the state first (picking does on
+// a click), and a CPU edit of one particle (dragging, pinning) is written
+// back with Cloth::particleChanged. Switching the cloth to another solver
+// fetches the state and hands it back to the CPU.
+struct ComputePrograms {
+    const ShaderManager* shaders = nullptr;
+    int integrate = -1, constraints = -1, faces = -1, vertices = -1;
+
+    // Loads the four programs; false (with a message) if any fails.
+    bool load(ShaderManager& manager);
+};
+
+class ClothCompute {
+public:
+    explicit ClothCompute(const ComputePrograms& computePrograms);
+    ~ClothCompute();
+
+    ClothCompute(const ClothCompute&) = delete;
+    ClothCompute& operator=(const ClothCompute&) = delete;
+
+    static bool supported();
+
+    // Copies the cloth's state and topology into the buffers (sized anew,
+    // e.g. after a tear) and keeps it there.
+    void upload(Cloth& cloth);
+    // Copies positions, old positions, normals and tangents into
+    // cloth.particles. The GPU state stays live.
+    void download(Cloth& cloth);
+    // Writes one particle's position, old position and pin flag.
+    void writeParticle(const Cloth& cloth, size_t index);
+    // The step Cloth::update would take, with its damping and step ratio.
+    void step(Cloth& cloth, float dt, float damping, float stepRatio, glm::vec3 wind);
+    void draw(RenderMode mode);
+
+    // Release GL objects; call before the context goes away.
+    void release();
+
+    // The buffers hold the cloth's state
+    bool resident = false;
+
+private:
+    static const int BOUNDS_RING = 4;
+
+    void readBounds(Cloth& cloth);
+
+    const ComputePrograms& programs;
+    unsigned int VAO = 0;
+    unsigned int vertexBuffer = 0, stateBuffer = 0, linkBuffer = 0;
+    unsigned int faceBuffer = 0, fanBuffer = 0, fanTriangleBuffer = 0;
+    unsigned int boundsBuffers[BOUNDS_RING] = {};
+    GLsync boundsFences[BOUNDS_RING] = {};
+    int boundsSlot = 0; // the next step writes this one
+    size_t particleCount = 0, triangleCount = 0;
+};
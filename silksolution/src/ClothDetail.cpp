@@ -0,0 +1,312 @@
+#include "ClothDetail.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define SILK_DETAIL_SSE 1
+#endif
+
+namespace {
+
+// Catmull-Rom weights for the four control points around t in [0, 1).
+void catmullRomWeights(float t, float w[4]) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    w[0] = 0.5f * (-t3 + 2.0f * t2 - t);
+    w[1] = 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f);
+    w[2] = 0.5f * (-3.0f * t3 + 4.0f * t2 + t);
+    w[3] = 0.5f * (t3 - t2);
+}
+
+// out[i] = w0 * a[i] + w1 * b[i] + w2 * c[i] + w3 * d[i]
+void weightedSum4(const float* a, const float* b, const float* c, const float* d, const float w[4], float* out, int n) {
+    int i = 0;
+#ifdef SILK_DETAIL_SSE
+    const __m128 w0 = _mm_set1_ps(w[0]);
+    const __m128 w1 = _mm_set1_ps(w[1]);
+    const __m128 w2 = _mm_set1_ps(w[2]);
+    const __m128 w3 = _mm_set1_ps(w[3]);
+    for (; i + 4 <= n; i += 4) {
+        __m128 r = _mm_mul_ps(w0, _mm_loadu_ps(a + i));
+        r = _mm_add_ps(r, _mm_mul_ps(w1, _mm_loadu_ps(b + i)));
+        r = _mm_add_ps(r, _mm_mul_ps(w2, _mm_loadu_ps(c + i)));
+        r = _mm_add_ps(r, _mm_mul_ps(w3, _mm_loadu_ps(d + i)));
+        _mm_storeu_ps(out + i, r);
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = w[0] * a[i] + w[1] * b[i] + w[2] * c[i] + w[3] * d[i];
+    }
+}
+
+glm::vec3 planePos(const std::vector<float>* planes, int i) {
+    return glm::vec3(planes[0][i], planes[1][i], planes[2][i]);
+}
+
+// Central differences on the refined grid, one-sided at the border.
+void gradients(const std::vector<float>* planes, int w, int h, int x, int y, glm::vec3& du, glm::vec3& dv) {
+    int x0 = x > 0 ? x - 1 : x, x1 = x < w - 1 ? x + 1 : x;
+    int y0 = y > 0 ? y - 1 : y, y1 = y < h - 1 ? y + 1 : y;
+    du = planePos(planes, y * w + x1) - planePos(planes, y * w + x0);
+    dv = planePos(planes, y1 * w + x) - planePos(planes, y0 * w + x);
+}
+
+} // namespace
+
+ClothDetail::ClothDetail(int subdiv) : subdivisions(subdiv < 1 ? 1 : subdiv) {
+}
+
+ClothDetail::~ClothDetail() {
+    release();
+}
+
+bool ClothDetail::tessellationSupported() {
+    return GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader;
+}
+
+void ClothDetail::release() {
+    if (tessVAO) glDeleteVertexArrays(1, &tessVAO);
+    if (compressionVBO) glDeleteBuffers(1, &compressionVBO);
+    if (patchEBO) glDeleteBuffers(1, &patchEBO);
+    if (subVAO) glDeleteVertexArrays(1, &subVAO);
+    if (subVBO) glDeleteBuffers(1, &subVBO);
+    if (subEBO) glDeleteBuffers(1, &subEBO);
+    tessVAO = compressionVBO = patchEBO = 0;
+    subVAO = subVBO = subEBO = 0;
+    boundCloth = nullptr;
+}
+
+void ClothDetail::bind(const Cloth& cloth) {
+    // Buffers are sized for (and the patch VAO reads from) one cloth; a LOD
+    // switch hands us a different grid.
+    if (boundCloth == &cloth) return;
+    release();
+    boundCloth = &cloth;
+}
+
+void ClothDetail::computeCompression(const Cloth& cloth) {
+    comp.assign(cloth.particles.size(), glm::vec2(0.0f));
+    const Particle* base = cloth.particles.data();
+
+    for (const auto& c : cloth.constraints) {
+        if (c.type != STRUCTURAL || c.restDistance <= 0.0f) continue;
+        float amount = std::max(0.0f, 1.0f - glm::distance(c.p1->position, c.p2->position) / c.restDistance);
+        size_t i1 = c.p1 - base;
+        size_t i2 = c.p2 - base;
+        // Grid neighbours one index apart are horizontal, one row apart vertical.
+        int axis = (i2 > i1 ? i2 - i1 : i1 - i2) == 1 ? 0 : 1;
+        comp[i1][axis] = std::max(comp[i1][axis], amount);
+        comp[i2][axis] = std::max(comp[i2][axis], amount);
+    }
+}
+
+// ------------------------------------------
+// GPU tessellation path
+// ------------------------------------------
+void ClothDetail::setupTessellation(const Cloth& cloth) {
+    const int w = cloth.width, h = cloth.height;
+    std::vector<unsigned int> patches;
+    patches.reserve(static_cast<size_t>(w - 1) * (h - 1) * 16);
+    for (int y = 0; y < h - 1; y++) {
+        for (int x = 0; x < w - 1; x++) {
+            for (int j = -1; j <= 2; j++) {
+                int py = std::clamp(y + j, 0, h - 1);
+                for (int i = -1; i <= 2; i++) {
+                    int px = std::clamp(x + i, 0, w - 1);
+                    patches.push_back(py * w + px);
+                }
+            }
+        }
+    }
+    patchIndexCount = static_cast<int>(patches.size());
+
+    glGenVertexArrays(1, &tessVAO);
+    glGenBuffers(1, &compressionVBO);
+    glGenBuffers(1, &patchEBO);
+
+    glBindVertexArray(tessVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cloth.VBO);
+    GLsizei stride = 11 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, compressionVBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(cloth.particles.size() * sizeof(glm::vec2)), NULL, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(patches.size() * sizeof(unsigned int)), patches.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ClothDetail::drawTessellated(Cloth& cloth) {
+    bind(cloth);
+    cloth.uploadVertices(); // creates the cloth's VBO on first use
+    if (!tessVAO) setupTessellation(cloth);
+
+    glBindBuffer(GL_ARRAY_BUFFER, compressionVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(comp.size() * sizeof(glm::vec2)), comp.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(tessVAO);
+    glPatchParameteri(GL_PATCH_VERTICES, 16);
+    glDrawElements(GL_PATCHES, patchIndexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+// ------------------------------------------
+// CPU subdivision fallback
+// ------------------------------------------
+void ClothDetail::setupSubdivision(const Cloth& cloth) {
+    fineW = (cloth.width - 1) * subdivisions + 1;
+    fineH = (cloth.height - 1) * subdivisions + 1;
+    const size_t coarseCount = cloth.particles.size();
+    const size_t fineCount = static_cast<size_t>(fineW) * fineH;
+
+    for (int p = 0; p < 5; p++) {
+        coarse[p].resize(coarseCount);
+        rows[p].resize(static_cast<size_t>(cloth.height) * fineW);
+        fine[p].resize(fineCount);
+    }
+    for (int p = 0; p < 3; p++) normals[p].resize(fineCount);
+    vertexData.resize(fineCount * 11);
+
+    basis.resize(static_cast<size_t>(subdivisions) * 4);
+    for (int s = 0; s < subdivisions; s++) catmullRomWeights(static_cast<float>(s) / subdivisions, &basis[s * 4]);
+
+    std::vector<unsigned int> tris;
+    tris.reserve(static_cast<size_t>(fineW - 1) * (fineH - 1) * 6);
+    for (int y = 0; y < fineH - 1; y++) {
+        for (int x = 0; x < fineW - 1; x++) {
+            unsigned int topLeft = y * fineW + x;
+            unsigned int topRight = topLeft + 1;
+            unsigned int bottomLeft = (y + 1) * fineW + x;
+            unsigned int bottomRight = bottomLeft + 1;
+            tris.insert(tris.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+        }
+    }
+    subIndexCount = static_cast<int>(tris.size());
+
+    glGenVertexArrays(1, &subVAO);
+    glGenBuffers(1, &subVBO);
+    glGenBuffers(1, &subEBO);
+
+    glBindVertexArray(subVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, subVBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertexData.size() * sizeof(float)), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(tris.size() * sizeof(unsigned int)), tris.data(), GL_STATIC_DRAW);
+
+    GLsizei stride = 11 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ClothDetail::subdivide(const Cloth& cloth) {
+    const int w = cloth.width, h = cloth.height, L = subdivisions;
+
+    for (size_t i = 0; i < cloth.particles.size(); i++) {
+        const glm::vec3& p = cloth.particles[i].position;
+        coarse[0][i] = p.x;
+        coarse[1][i] = p.y;
+        coarse[2][i] = p.z;
+        coarse[3][i] = i < comp.size() ? comp[i].x : 0.0f;
+        coarse[4][i] = i < comp.size() ? comp[i].y : 0.0f;
+    }
+
+    // Pass 1: refine each coarse row along x.
+    for (int p = 0; p < 5; p++) {
+        for (int y = 0; y < h; y++) {
+            const float* src = &coarse[p][static_cast<size_t>(y) * w];
+            float* dst = &rows[p][static_cast<size_t>(y) * fineW];
+            for (int x = 0; x < w - 1; x++) {
+                float a = src[std::max(x - 1, 0)], b = src[x], c = src[x + 1], d = src[std::min(x + 2, w - 1)];
+                for (int s = 0; s < L; s++) {
+                    const float* wt = &basis[s * 4];
+                    dst[x * L + s] = wt[0] * a + wt[1] * b + wt[2] * c + wt[3] * d;
+                }
+            }
+            dst[fineW - 1] = src[w - 1];
+        }
+    }
+
+    // Pass 2: refine along y by blending whole refined rows (SIMD).
+    for (int p = 0; p < 5; p++) {
+        auto row = [&](int y) { return &rows[p][static_cast<size_t>(std::clamp(y, 0, h - 1)) * fineW]; };
+        for (int y = 0; y < h - 1; y++) {
+            for (int s = 0; s < L; s++) {
+                float* dst = &fine[p][static_cast<size_t>(y * L + s) * fineW];
+                weightedSum4(row(y - 1), row(y), row(y + 1), row(y + 2), &basis[s * 4], dst, fineW);
+            }
+        }
+        std::copy(row(h - 1), row(h - 1) + fineW, &fine[p][static_cast<size_t>(fineH - 1) * fineW]);
+    }
+
+    // Wrinkle displacement along the smooth surface normal.
+    const float k = 6.2831853f * wrinkleFrequency;
+    for (int y = 0; y < fineH; y++) {
+        float v = static_cast<float>(y) / (fineH - 1);
+        for (int x = 0; x < fineW; x++) {
+            size_t i = static_cast<size_t>(y) * fineW + x;
+            float u = static_cast<float>(x) / (fineW - 1);
+            glm::vec3 du, dv;
+            gradients(fine, fineW, fineH, x, y, du, dv);
+            glm::vec3 n = glm::normalize(glm::cross(dv, du));
+            float disp = wrinkleAmplitude * (std::max(fine[3][i], 0.0f) * std::sin(k * u) + std::max(fine[4][i], 0.0f) * std::sin(k * v));
+            normals[0][i] = n.x * disp;
+            normals[1][i] = n.y * disp;
+            normals[2][i] = n.z * disp;
+        }
+    }
+    for (int p = 0; p < 3; p++) {
+        float* dst = fine[p].data();
+        const float* off = normals[p].data();
+        for (size_t i = 0; i < fine[p].size(); i++) dst[i] += off[i];
+    }
+
+    // Pack with normals and tangents of the displaced surface.
+    float* out = vertexData.data();
+    for (int y = 0; y < fineH; y++) {
+        for (int x = 0; x < fineW; x++) {
+            size_t i = static_cast<size_t>(y) * fineW + x;
+            glm::vec3 du, dv;
+            gradients(fine, fineW, fineH, x, y, du, dv);
+            glm::vec3 n = glm::normalize(glm::cross(dv, du));
+            glm::vec3 t = glm::normalize(dv);
+            *out++ = fine[0][i]; *out++ = fine[1][i]; *out++ = fine[2][i];
+            *out++ = n.x;        *out++ = n.y;        *out++ = n.z;
+            *out++ = static_cast<float>(x) / (fineW - 1);
+            *out++ = static_cast<float>(y) / (fineH - 1);
+            *out++ = t.x;        *out++ = t.y;        *out++ = t.z;
+        }
+    }
+}
+
+void ClothDetail::drawSubdivided(Cloth& cloth) {
+    bind(cloth);
+    if (!subVAO) setupSubdivision(cloth);
+    subdivide(cloth);
+
+    glBindVertexArray(subVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, subVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(vertexData.size() * sizeof(float)), vertexData.data());
+    glDrawElements(GL_TRIANGLES, subIndexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
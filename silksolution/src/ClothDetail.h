@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Cloth.h"
+
+#include <vector>
+
+// ==========================================
+// Cloth Surface Detail
+// ==========================================
+// Renders a smooth Catmull-Rom surface through the simulated grid instead of
+// raising the simulation resolution, with optional wrinkles displaced along
+// the normal where structural constraints are compressed.
+//   drawTessellated - GL 4.0 tessellation: one 16-control-point patch per grid
+//                     cell, evaluated in shaders/fabric_tess.tese.
+//   drawSubdivided  - CPU fallback evaluating the same surface into a refined
+//                     grid with SSE row kernels, drawn with the fabric shader.
+// Both paths expect the matching program to be bound and the per-frame
+// uniforms set by the caller.
+class ClothDetail {
+public:
+    explicit ClothDetail(int subdivisions = 4);
+    ~ClothDetail();
+
+    ClothDetail(const ClothDetail&) = delete;
+    ClothDetail& operator=(const ClothDetail&) = delete;
+
+    static bool tessellationSupported();
+
+    // Per-particle (horizontal, vertical) compression, 1 - length / rest,
+    // taken from the structural constraints. Stretched constraints count as 0.
+    void computeCompression(const Cloth& cloth);
+
+    void drawTessellated(Cloth& cloth);
+    void drawSubdivided(Cloth& cloth);
+
+    // Release GL objects; call before the context goes away.
+    void release();
+
+    const int subdivisions;
+    float wrinkleAmplitude = 0.15f;
+    float wrinkleFrequency = 24.0f;
+
+    const std::vector<glm::vec2>& compression() const { return comp; }
+
+private:
+    void bind(const Cloth& cloth);
+    void setupTessellation(const Cloth& cloth);
+    void setupSubdivision(const Cloth& cloth);
+    void subdivide(const Cloth& cloth);
+
+    std::vector<glm::vec2> comp;
+    const Cloth* boundCloth = nullptr;
+
+    // Tessellation path
+    unsigned int tessVAO = 0, compressionVBO = 0, patchEBO = 0;
+    int patchIndexCount = 0;
+
+    // CPU subdivision path (SoA planes: x, y, z, compression x, compression y)
+    unsigned int subVAO = 0, subVBO = 0, subEBO = 0;
+    int subIndexCount = 0;
+    int fineW = 0, fineH = 0;
+    std::vector<float> coarse[5];
+    std::vector<float> rows[5];
+    std::vector<float> fine[5];
+    std::vector<float> normals[3];
+    std::vector<float> vertexData;
+    std::vector<float> basis; // Catmull-Rom weights per sub-sample
+};
@@ -0,0 +1,127 @@
+#include "ClothLOD.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+ClothLOD::ClothLOD(int w, int h, int levelCount, const ClothParams& params) {
+    levels.push_back(std::make_unique<Cloth>(w, h, params));
+
+    while ((int)levels.size() < levelCount) {
+        const Cloth& fine = *levels.back();
+        if (!GridTransfer::canCoarsen(fine.width, fine.height)) break;
+
+        transfers.emplace_back(fine.width, fine.height);
+        const GridTransfer& t = transfers.back();
+
+        // Sample the rest layout, before anything has been simulated.
+        std::vector<Particle> sampled;
+        sampled.reserve(t.coarseToFine.size());
+        for (int fineIndex : t.coarseToFine) {
+            Particle p = fine.particles[fineIndex];
+            p.oldPosition = p.position;
+            p.acceleration = glm::vec3(0.0f);
+            sampled.push_back(p);
+        }
+        // A pin between two samples holds both of them, otherwise the coarse
+        // edge sags where the fine one cannot and prolongation tears it.
+        for (size_t i = 0; i < fine.particles.size(); i++) {
+            if (!fine.particles[i].isPinned) continue;
+            const GridTransfer::Stencil& s = t.prolongation[i];
+            for (int k = 0; k < 4; k++) {
+                if (s.weight[k] > 0.0f) sampled[s.node[k]].isPinned = true;
+            }
+        }
+        levels.push_back(std::make_unique<Cloth>(t.coarseWidth, t.coarseHeight, std::move(sampled), fine.params));
+    }
+}
+
+ClothLOD::ClothLOD(std::unique_ptr<Cloth> cloth) {
+    levels.push_back(std::move(cloth));
+}
+
+float ClothLOD::projectedCellPixels(int lvl, const glm::mat4& viewProjection, int viewportW, int viewportH) const {
+    const glm::vec3& lo = levels[current]->boundsMin;
+    const glm::vec3& hi = levels[current]->boundsMax;
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner(i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z, 1.0f);
+        glm::vec4 clip = viewProjection * corner;
+        if (clip.w <= 1e-4f) return -1.0f;
+        float sx = (clip.x / clip.w * 0.5f + 0.5f) * viewportW;
+        float sy = (clip.y / clip.w * 0.5f + 0.5f) * viewportH;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+    }
+
+    const Cloth& target = *levels[lvl];
+    float cells = static_cast<float>((target.width - 1) * (target.height - 1));
+    return std::sqrt((maxX - minX) * (maxY - minY) / cells);
+}
+
+bool ClothLOD::selectLevel(const glm::mat4& viewProjection, int viewportW, int viewportH) {
+    if (frozen || levels.size() < 2) return false;
+
+    const int last = levelCount() - 1;
+    auto cellPixels = [&](int lvl) {
+        float px = projectedCellPixels(lvl, viewProjection, viewportW, viewportH);
+        return px < 0.0f ? FLT_MAX : px; // straddling the camera: as close as it gets
+    };
+
+    int target = current;
+    while (target > 0 && cellPixels(target - 1) >= minCellPixels * (1.0f + hysteresis)) target--;
+    while (target < last && cellPixels(target) < minCellPixels * (1.0f - hysteresis)) target++;
+
+    if (target == current) return false;
+    setLevel(target);
+    return true;
+}
+
+void ClothLOD::setLevel(int target) {
+    target = std::clamp(target, 0, levelCount() - 1);
+    while (current < target) restrictLevel(current++);
+    while (current > target) prolongLevel(current--);
+    levels[current]->recalculateNormals();
+}
+
+void ClothLOD::translate(glm::vec3 offset) {
+    for (auto& cloth : levels) cloth->translate(offset);
+}
+
+void ClothLOD::restrictLevel(int fine) {
+    const Cloth& src = *levels[fine];
+    Cloth& dst = *levels[fine + 1];
+    const GridTransfer& t = transfers[fine];
+    dst.setLastStepLength(src.lastStepLength());
+
+    for (size_t i = 0; i < t.coarseToFine.size(); i++) {
+        const Particle& p = src.particles[t.coarseToFine[i]];
+        Particle& q = dst.particles[i];
+        if (q.isPinned) continue;
+        q.position = p.position;
+        q.oldPosition = p.oldPosition;
+        q.acceleration = glm::vec3(0.0f);
+    }
+}
+
+void ClothLOD::prolongLevel(int coarse) {
+    const Cloth& src = *levels[coarse];
+    Cloth& dst = *levels[coarse - 1];
+    const GridTransfer& t = transfers[coarse - 1];
+    dst.setLastStepLength(src.lastStepLength());
+
+    for (size_t i = 0; i < dst.particles.size(); i++) {
+        Particle& q = dst.particles[i];
+        if (q.isPinned) continue;
+        const GridTransfer::Stencil& s = t.prolongation[i];
+        glm::vec3 pos(0.0f), old(0.0f);
+        for (int k = 0; k < 4; k++) {
+            pos += src.particles[s.node[k]].position * s.weight[k];
+            old += src.particles[s.node[k]].oldPosition * s.weight[k];
+        }
+        q.position = pos;
+        q.oldPosition = old;
+        q.acceleration = glm::vec3(0.0f);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Cloth.h"
+#include "GridTransfer.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// ==========================================
+// Cloth Level of Detail
+// ==========================================
+// A hierarchy of cloth grids (full, 1/2, 1/4, ...) of which only one is
+// simulated and drawn. Each coarser level is built from every other particle
+// of the finer rest layout, so pins and uvs line up. The level follows the
+// projected size of a grid cell on screen; on a switch the particle state
+// (position and old position, i.e. the Verlet velocity) is restricted or
+// prolongated level by level. The hysteresis band keeps a cloth sitting at
+// a threshold from popping back and forth.
+class ClothLOD {
+public:
+    ClothLOD(int w, int h, int levelCount = 3, const ClothParams& params = ClothParams());
+    // A single level, for a cloth that is no grid (an imported mesh).
+    explicit ClothLOD(std::unique_ptr<Cloth> cloth);
+
+    Cloth& active() { return *levels[current]; }
+    Cloth& level(int i) { return *levels[i]; }
+    int activeLevel() const { return current; }
+    int levelCount() const { return static_cast<int>(levels.size()); }
+
+    // Re-evaluates the level from the active cloth's screen footprint.
+    // Returns true when the level changed.
+    bool selectLevel(const glm::mat4& viewProjection, int viewportW, int viewportH);
+    // Switches levels, carrying the simulation state across.
+    void setLevel(int target);
+    // Moves every level.
+    void translate(glm::vec3 offset);
+
+    // Edge length in pixels of one cell of the given level, estimated from
+    // the projected bounds of the active cloth (as its last normal pass left
+    // them). Negative if the bounds cross the camera plane.
+    float projectedCellPixels(int lvl, const glm::mat4& viewProjection, int viewportW, int viewportH) const;
+
+    // Use the finest level whose cells still cover this many pixels.
+    float minCellPixels = 4.0f;
+    // Fraction of minCellPixels a cell must move past the threshold to switch.
+    float hysteresis = 0.25f;
+    // Holds the current level, e.g. while a particle index is in use.
+    bool frozen = false;
+
+private:
+    void restrictLevel(int fine);
+    void prolongLevel(int coarse);
+
+    std::vector<std::unique_ptr<Cloth>> levels;
+    std::vector<GridTransfer> transfers; // transfers[i]: level i <-> level i + 1
+    int current = 0;
+};
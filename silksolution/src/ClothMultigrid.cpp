@@ -0,0 +1,161 @@
+#include "ClothMultigrid.h"
+
+#include "Cloth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+// Coarsen while both sides keep a few cells; below that the coarsest level
+// is solved outright.
+const int MIN_COARSE_SIZE = 5;
+
+} // namespace
+
+ClothMultigrid::ClothMultigrid(const Cloth& cloth, const std::vector<glm::vec3>& restLayout) {
+    int w = cloth.width, h = cloth.height;
+    std::vector<glm::vec3> rest = restLayout;
+
+    while (GridTransfer::canCoarsen(w, h)) {
+        GridTransfer t(w, h);
+        if (t.coarseWidth < MIN_COARSE_SIZE || t.coarseHeight < MIN_COARSE_SIZE) break;
+
+        Level level;
+        level.width = t.coarseWidth;
+        level.height = t.coarseHeight;
+        level.position.resize(t.coarseToFine.size());
+        for (size_t i = 0; i < t.coarseToFine.size(); i++) level.position[i] = rest[t.coarseToFine[i]];
+        level.start = level.position;
+        level.pinned.assign(level.position.size(), 0);
+
+        auto addLink = [&](int x1, int y1, int x2, int y2, float k) {
+            if (x2 < 0 || x2 >= level.width || y2 >= level.height) return;
+            int a = y1 * level.width + x1, b = y2 * level.width + x2;
+            level.links.push_back({ a, b, glm::distance(level.position[a], level.position[b]), k });
+        };
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++) {
+                addLink(x, y, x + 1, y, cloth.params.structuralStiffness);
+                addLink(x, y, x, y + 1, cloth.params.structuralStiffness);
+                addLink(x, y, x + 1, y + 1, cloth.params.shearStiffness);
+                addLink(x, y, x - 1, y + 1, cloth.params.shearStiffness);
+            }
+        }
+
+        rest = level.position;
+        w = level.width;
+        h = level.height;
+        transfers.push_back(std::move(t));
+        levels.push_back(std::move(level));
+    }
+}
+
+void ClothMultigrid::refreshPins(const Cloth& cloth) {
+    for (size_t l = 0; l < levels.size(); l++) {
+        Level& level = levels[l];
+        const GridTransfer& t = transfers[l];
+        std::fill(level.pinned.begin(), level.pinned.end(), 0);
+
+        const size_t fineCount = static_cast<size_t>(t.fineWidth) * t.fineHeight;
+        for (size_t i = 0; i < fineCount; i++) {
+            bool finePinned = l == 0 ? cloth.particles[i].isPinned : levels[l - 1].pinned[i] != 0;
+            if (!finePinned) continue;
+            const GridTransfer::Stencil& s = t.prolongation[i];
+            for (int k = 0; k < 4; k++) {
+                if (s.weight[k] > 0.0f) level.pinned[s.node[k]] = 1;
+            }
+        }
+    }
+}
+
+void ClothMultigrid::smooth(Level& level, int iterations) {
+    glm::vec3* pos = level.position.data();
+    const unsigned char* pinned = level.pinned.data();
+    for (int it = 0; it < iterations; it++) {
+        for (const Link& c : level.links) {
+            glm::vec3 delta = pos[c.b] - pos[c.a];
+            float currentDist = glm::length(delta);
+            if (currentDist == 0.0f) continue;
+
+            float correctionAmount = (currentDist - c.restDistance) / currentDist;
+            glm::vec3 correction = delta * correctionAmount * 0.5f * c.stiffness;
+
+            if (!pinned[c.a]) pos[c.a] += correction;
+            if (!pinned[c.b]) pos[c.b] -= correction;
+        }
+    }
+}
+
+void ClothMultigrid::cycle(int lvl) {
+    Level& level = levels[lvl];
+    level.start = level.position;
+
+    if (lvl + 1 == levelCount()) {
+        smooth(level, coarsestIterations);
+        return;
+    }
+
+    smooth(level, preSmooth);
+
+    Level& coarse = levels[lvl + 1];
+    const GridTransfer& t = transfers[lvl + 1];
+    for (size_t i = 0; i < t.coarseToFine.size(); i++) coarse.position[i] = level.position[t.coarseToFine[i]];
+    cycle(lvl + 1);
+    for (size_t i = 0; i < level.position.size(); i++) {
+        if (level.pinned[i]) continue;
+        const GridTransfer::Stencil& s = t.prolongation[i];
+        for (int k = 0; k < 4; k++) {
+            level.position[i] += (coarse.position[s.node[k]] - coarse.start[s.node[k]]) * s.weight[k];
+        }
+    }
+
+    smooth(level, postSmooth);
+}
+
+void ClothMultigrid::solve(Cloth& cloth, int cycles) {
+    auto smoothFine = [&](int iterations) {
+        for (int i = 0; i < iterations; i++) {
+            for (auto& c : cloth.constraints) c.solve();
+        }
+    };
+
+    if (levels.empty()) {
+        smoothFine(cycles * (preSmooth + postSmooth));
+        return;
+    }
+
+    refreshPins(cloth);
+    Level& coarse = levels[0];
+    const GridTransfer& t = transfers[0];
+
+    for (int c = 0; c < cycles; c++) {
+        smoothFine(preSmooth);
+
+        for (size_t i = 0; i < t.coarseToFine.size(); i++) coarse.position[i] = cloth.particles[t.coarseToFine[i]].position;
+        cycle(0);
+        for (size_t i = 0; i < cloth.particles.size(); i++) {
+            Particle& p = cloth.particles[i];
+            if (p.isPinned) continue;
+            const GridTransfer::Stencil& s = t.prolongation[i];
+            for (int k = 0; k < 4; k++) {
+                p.position += (coarse.position[s.node[k]] - coarse.start[s.node[k]]) * s.weight[k];
+            }
+        }
+
+        smoothFine(postSmooth);
+    }
+}
+
+float ClothMultigrid::residual(const Cloth& cloth) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (const auto& c : cloth.constraints) {
+        if (c.type != STRUCTURAL || c.restDistance == 0.0f) continue;
+        float strain = (glm::distance(c.p1->position, c.p2->position) - c.restDistance) / c.restDistance;
+        sum += strain * strain;
+        count++;
+    }
+    return count ? static_cast<float>(std::sqrt(sum / count)) : 0.0f;
+}
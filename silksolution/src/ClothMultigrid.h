@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GridTransfer.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class Cloth;
+
+// ==========================================
+// Multigrid Constraint Solver
+// ==========================================
+// Gauss-Seidel moves a correction one grid cell per sweep, so low-frequency
+// stretch on a large cloth needs O(n) sweeps. The V-cycle here smooths the
+// fine grid with the cloth's own constraints and hands the remaining smooth
+// error to coarser grids (every other row and column, structural and shear
+// links measured on the rest layout):
+//   pre-smooth -> inject positions down -> recurse -> prolongate the coarse
+//   displacement back up (bilinear) -> post-smooth
+// A coarse node is pinned whenever a finer pin interpolates from it, which
+// also covers the particle held by the mouse.
+class ClothMultigrid {
+public:
+    // Levels measured on the cloth's rest layout, rest[i] for particle i.
+    ClothMultigrid(const Cloth& cloth, const std::vector<glm::vec3>& rest);
+
+    void solve(Cloth& cloth, int cycles);
+
+    int levelCount() const { return static_cast<int>(levels.size()); }
+
+    int preSmooth = 1;
+    int postSmooth = 1;
+    int coarsestIterations = 10;
+
+    // RMS relative strain of the structural constraints, |l - l0| / l0.
+    static float residual(const Cloth& cloth);
+
+private:
+    struct Link {
+        int a, b;
+        float restDistance;
+        float stiffness;
+    };
+
+    struct Level {
+        int width, height;
+        std::vector<glm::vec3> position;
+        std::vector<glm::vec3> start; // position on entry, for the correction
+        std::vector<unsigned char> pinned;
+        std::vector<Link> links;
+    };
+
+    void refreshPins(const Cloth& cloth);
+    void cycle(int lvl);
+    void smooth(Level& level, int iterations);
+
+    std::vector<Level> levels;          // coarse levels, levels[0] is 1/2 resolution
+    std::vector<GridTransfer> transfers; // transfers[i]: finer grid -> levels[i]
+};
@@ -0,0 +1,125 @@
+#include "ClothScene.h"
+
+#include <algorithm>
+
+namespace {
+
+// Stepping it makes GL calls: compute dispatches, or the fetch when it
+// leaves the compute solver
+bool stepsOnGpu(const Cloth& cloth) {
+    return (cloth.solver == SOLVER_COMPUTE && cloth.compute) || cloth.onGpu();
+}
+
+} // namespace
+
+ClothScene::ClothScene(TaskPool& taskPool) : pool(taskPool), wind(0.0f) {
+}
+
+ClothPanel& ClothScene::add(int w, int h, glm::vec3 offset) {
+    ClothPanel panel;
+    panel.lod = std::make_unique<ClothLOD>(w, h);
+    panel.lod->translate(offset);
+    panel.detail = std::make_unique<ClothDetail>();
+    panels.push_back(std::move(panel));
+    return panels.back();
+}
+
+ClothPanel& ClothScene::add(std::unique_ptr<Cloth> cloth, glm::vec3 offset) {
+    ClothPanel panel;
+    panel.lod = std::make_unique<ClothLOD>(std::move(cloth));
+    panel.lod->translate(offset);
+    panel.detail = std::make_unique<ClothDetail>();
+    panels.push_back(std::move(panel));
+    return panels.back();
+}
+
+void ClothScene::enableCompute(const ComputePrograms& programs) {
+    for (auto& panel : panels) {
+        for (int i = 0; i < panel.lod->levelCount(); i++) {
+            panel.lod->level(i).compute = std::make_unique<ClothCompute>(programs);
+        }
+    }
+}
+
+void ClothScene::step(float stepDt, glm::vec3 stepWind) {
+    dt = stepDt;
+    wind = stepWind;
+    if (panels.size() == 1) {
+        panels[0].lod->active().update(dt, wind, &pool);
+        return;
+    }
+
+    TaskPool::Group group;
+    for (int i = 0; i < size(); i++) {
+        if (stepsOnGpu(panels[i].lod->active())) continue;
+        pool.spawn(group, [](void* context, int index) {
+            ClothScene& scene = *static_cast<ClothScene*>(context);
+            scene.panels[index].lod->active().update(scene.dt, scene.wind, &scene.pool);
+        }, this, i);
+    }
+    for (auto& panel : panels) {
+        Cloth& cloth = panel.lod->active();
+        if (stepsOnGpu(cloth)) cloth.update(dt, wind);
+    }
+    pool.wait(group);
+}
+
+ClothMotion ClothScene::measureMotion() {
+    if (panels.size() == 1) return panels[0].lod->active().measureMotion(&pool);
+
+    motions.resize(panels.size());
+    TaskPool::Group group;
+    for (int i = 0; i < size(); i++) {
+        pool.spawn(group, [](void* context, int index) {
+            ClothScene& scene = *static_cast<ClothScene*>(context);
+            scene.motions[index] = scene.panels[index].lod->active().measureMotion(&scene.pool);
+        }, this, i);
+    }
+    pool.wait(group);
+
+    ClothMotion worst;
+    for (const ClothMotion& m : motions) {
+        if (!(m.maxStrain <= worst.maxStrain)) worst.maxStrain = m.maxStrain;
+        worst.maxSpeed = std::max(worst.maxSpeed, m.maxSpeed);
+    }
+    return worst;
+}
+
+int ClothScene::cull(const glm::mat4& m) {
+    // Frustum planes from the combined matrix (Gribb & Hartmann); a box is
+    // out when its corner furthest along a plane normal is behind the plane.
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+        glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+        planes[2 * i] = w + row;
+        planes[2 * i + 1] = w - row;
+    }
+
+    int visibleCount = 0;
+    for (auto& panel : panels) {
+        const Cloth& cloth = panel.lod->active();
+        glm::vec3 lo = cloth.boundsMin - glm::vec3(cullMargin);
+        glm::vec3 hi = cloth.boundsMax + glm::vec3(cullMargin);
+
+        panel.visible = true;
+        for (const glm::vec4& plane : planes) {
+            glm::vec3 far(plane.x >= 0.0f ? hi.x : lo.x, plane.y >= 0.0f ? hi.y : lo.y, plane.z >= 0.0f ? hi.z : lo.z);
+            if (plane.x * far.x + plane.y * far.y + plane.z * far.z + plane.w < 0.0f) {
+                panel.visible = false;
+                break;
+            }
+        }
+        if (panel.visible) visibleCount++;
+    }
+    return visibleCount;
+}
+
+void ClothScene::release() {
+    for (auto& panel : panels) {
+        panel.detail->release();
+        for (int i = 0; i < panel.lod->levelCount(); i++) {
+            if (panel.lod->level(i).compute) panel.lod->level(i).compute->release();
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ClothCompute.h"
+#include "ClothDetail.h"
+#include "ClothLOD.h"
+#include "TaskPool.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// ==========================================
+// Cloth Scene
+// ==========================================
+// Any number of independent cloth panels (each with its LOD levels and
+// surface detail buffers). step() runs one pool task per panel; panels big
+// enough split their own update further, and idle threads steal those
+// sub-tasks. Panels on the compute solver are stepped on the calling
+// thread, which owns the context, while the pool runs the rest. cull()
+// tests every panel's bounds, which Cloth refreshes while computing
+// normals, against the view frustum.
+struct ClothPanel {
+    std::unique_ptr<ClothLOD> lod;
+    std::unique_ptr<ClothDetail> detail;
+    bool visible = true;
+};
+
+class ClothScene {
+public:
+    explicit ClothScene(TaskPool& pool);
+
+    // Adds a w x h panel, moved by offset from the default cloth placement.
+    ClothPanel& add(int w, int h, glm::vec3 offset);
+    // Adds a ready-made cloth, e.g. an imported garment, as a one-level panel.
+    ClothPanel& add(std::unique_ptr<Cloth> cloth, glm::vec3 offset);
+
+    int size() const { return static_cast<int>(panels.size()); }
+    ClothPanel& panel(int i) { return panels[i]; }
+
+    // Gives every level of every panel a compute solver, used while its
+    // solver is SOLVER_COMPUTE. programs must outlive the scene's GL objects.
+    void enableCompute(const ComputePrograms& programs);
+
+    void step(float dt, glm::vec3 wind);
+    // The worst strain and speed over all panels after the last step
+    ClothMotion measureMotion();
+
+    // Updates ClothPanel::visible; returns the number of visible panels.
+    int cull(const glm::mat4& viewProjection);
+
+    // Release GL objects; call before the context goes away.
+    void release();
+
+    // Grows the bounds before culling, for displacement added while drawing.
+    float cullMargin = 0.2f;
+
+private:
+    TaskPool& pool;
+    std::vector<ClothPanel> panels;
+    std::vector<ClothMotion> motions; // per panel, while measuring
+    glm::vec3 wind;
+    float dt = 0.0f;
+};
@@ -0,0 +1,115 @@
+#include "ColumnFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace ColumnFile {
+
+namespace {
+
+const char MAGIC[4] = { 'S', 'L', 'K', 'C' };
+const uint32_t VERSION = 1;
+
+} // namespace
+
+Writer::~Writer() {
+    close();
+}
+
+bool Writer::open(const std::string& path, const std::vector<Column>& columns, int groupSize) {
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    cols = columns;
+    rowsPerGroup = groupSize > 0 ? groupSize : 1;
+    group.resize(cols.size() * rowsPerGroup);
+    groupRows = 0;
+    written = 0;
+
+    uint32_t count = static_cast<uint32_t>(cols.size());
+    fwrite(MAGIC, 1, 4, file);
+    fwrite(&VERSION, 4, 1, file);
+    fwrite(&count, 4, 1, file);
+    for (const auto& c : cols) {
+        uint8_t type = c.type;
+        uint8_t length = static_cast<uint8_t>(std::min<size_t>(c.name.size(), 255));
+        fwrite(&type, 1, 1, file);
+        fwrite(&length, 1, 1, file);
+        fwrite(c.name.data(), 1, length, file);
+    }
+    fflush(file);
+    return true;
+}
+
+void Writer::append(const Value* row) {
+    if (!file) return;
+    for (size_t c = 0; c < cols.size(); c++) {
+        group[c * rowsPerGroup + groupRows] = row[c];
+    }
+    if (++groupRows == rowsPerGroup) flushGroup();
+}
+
+void Writer::flushGroup() {
+    if (groupRows == 0) return;
+    uint32_t rows = static_cast<uint32_t>(groupRows);
+    fwrite(&rows, 4, 1, file);
+    for (size_t c = 0; c < cols.size(); c++) {
+        fwrite(&group[c * rowsPerGroup], sizeof(Value), groupRows, file);
+    }
+    fflush(file);
+    written += groupRows;
+    groupRows = 0;
+}
+
+void Writer::close() {
+    if (!file) return;
+    flushGroup();
+    fclose(file);
+    file = nullptr;
+}
+
+Reader::~Reader() {
+    if (file) fclose(file);
+}
+
+bool Reader::open(const std::string& path) {
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, MAGIC, 4) != 0 ||
+        fread(&version, 4, 1, file) != 1 || version != VERSION || fread(&count, 4, 1, file) != 1) {
+        std::cout << "Not a column file: " << path << std::endl;
+        return false;
+    }
+
+    cols.resize(count);
+    for (auto& c : cols) {
+        uint8_t type = 0, length = 0;
+        if (fread(&type, 1, 1, file) != 1 || fread(&length, 1, 1, file) != 1) return false;
+        c.type = static_cast<Type>(type);
+        c.name.resize(length);
+        if (length && fread(&c.name[0], 1, length, file) != length) return false;
+    }
+    return true;
+}
+
+bool Reader::nextGroup(std::vector<Value>& values, int& rows) {
+    uint32_t count = 0;
+    if (!file || fread(&count, 4, 1, file) != 1) return false;
+    values.resize(cols.size() * count);
+    if (fread(values.data(), sizeof(Value), values.size(), file) != values.size()) return false;
+    rows = static_cast<int>(count);
+    return true;
+}
+
+} // namespace ColumnFile
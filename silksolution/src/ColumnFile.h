@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ==========================================
+// Column File
+// ==========================================
+// Compact binary table that can be appended to while it is being read:
+//   "SLKC", u32 version, u32 column count,
+//   per column: u8 type, u8 name length, name bytes
+//   row groups until end of file: u32 row count, then every column's values
+// All values are 4 bytes (int32 or float32) in the writer's byte order.
+// A group is flushed as soon as it is full, so a long sweep can be inspected
+// (or survive a crash) with everything but the last partial group intact.
+namespace ColumnFile {
+
+enum Type : uint8_t { INT32 = 1, FLOAT32 = 2 };
+
+struct Column {
+    std::string name;
+    Type type;
+};
+
+union Value {
+    int32_t i;
+    float f;
+};
+
+class Writer {
+public:
+    ~Writer();
+
+    bool open(const std::string& path, const std::vector<Column>& columns, int rowsPerGroup = 256);
+    // row holds one value per column
+    void append(const Value* row);
+    // Writes the last partial group and closes the file.
+    void close();
+
+    int rowsWritten() const { return written; }
+
+private:
+    void flushGroup();
+
+    FILE* file = nullptr;
+    std::vector<Column> cols;
+    std::vector<Value> group; // column-major, rowsPerGroup values per column
+    int rowsPerGroup = 0;
+    int groupRows = 0;
+    int written = 0;
+};
+
+class Reader {
+public:
+    ~Reader();
+
+    bool open(const std::string& path);
+    const std::vector<Column>& columns() const { return cols; }
+    // Next row group, column-major (values[c * rows + r]); false at the end.
+    bool nextGroup(std::vector<Value>& values, int& rows);
+
+private:
+    FILE* file = nullptr;
+    std::vector<Column> cols;
+};
+
+} // namespace ColumnFile
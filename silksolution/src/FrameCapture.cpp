@@ -0,0 +1,206 @@
+#include "FrameCapture.h"
+#include "FrameMemory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+FrameCapture::FrameCapture(int width, int height, int ringSize, const std::string& dir)
+    : w(width), h(height), outputDir(dir), ring(ringSize < 2 ? 2 : ringSize) {
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+    for (auto& slot : ring) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.pbo) glDeleteBuffers(1, &slot.pbo);
+    }
+    if (colorRb) glDeleteRenderbuffers(1, &colorRb);
+    if (depthRb) glDeleteRenderbuffers(1, &depthRb);
+    if (fbo) glDeleteFramebuffers(1, &fbo);
+}
+
+bool FrameCapture::init() {
+    std::error_code ec;
+    std::filesystem::create_directories(outputDir, ec);
+    if (ec) {
+        std::cout << "Failed to create output directory " << outputDir << std::endl;
+        return false;
+    }
+
+    // The writer fills in each frame's name in place
+    framePath = (std::filesystem::path(outputDir) / "").string();
+    framePrefix = framePath.size();
+    framePath.reserve(framePrefix + 32);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenRenderbuffers(1, &colorRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRb);
+
+    glGenRenderbuffers(1, &depthRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Offscreen framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        return false;
+    }
+
+    // RGBA rows keep the pack alignment trivial; the writer drops alpha.
+    const GLsizeiptr frameBytes = static_cast<GLsizeiptr>(w) * h * 4;
+    for (auto& slot : ring) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    images.resize(ring.size() + 2);
+    for (size_t i = 0; i < images.size(); i++) {
+        images[i].pixels.resize(static_cast<size_t>(frameBytes));
+        freeImages.push_back(static_cast<int>(i));
+    }
+    readyImages.reserve(images.size());
+
+    writer = std::thread(&FrameCapture::writerLoop, this);
+    return true;
+}
+
+void FrameCapture::beginFrame() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, w, h);
+}
+
+void FrameCapture::endFrame() {
+    Slot& slot = ring[frameIndex % ring.size()];
+    // The slot we are about to reuse still holds frame N - ringSize.
+    if (slot.frame >= 0) retire(slot);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frameIndex++;
+    // Make sure the fence reaches the GPU before we wait on it a few frames later.
+    glFlush();
+}
+
+void FrameCapture::retire(Slot& slot) {
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    int imageIndex;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return !freeImages.empty(); });
+        imageIndex = freeImages.back();
+        freeImages.pop_back();
+    }
+
+    Image& image = images[imageIndex];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(image.pixels.size()), GL_MAP_READ_BIT);
+    if (src) {
+        std::memcpy(image.pixels.data(), src, image.pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    image.frame = slot.frame;
+    slot.frame = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (src) readyImages.push_back(imageIndex);
+        else freeImages.push_back(imageIndex);
+    }
+    cv.notify_all();
+}
+
+void FrameCapture::finish() {
+    if (!writer.joinable()) return;
+
+    // Retire in submission order so frames reach the writer sorted.
+    for (size_t i = 0; i < ring.size(); i++) {
+        Slot& slot = ring[(frameIndex + i) % ring.size()];
+        if (slot.frame >= 0) retire(slot);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    writer.join();
+}
+
+void FrameCapture::writerLoop() {
+    setThreadAllocationPhase(PHASE_CAPTURE);
+    for (;;) {
+        int imageIndex;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return readyHead < readyImages.size() || stopping; });
+            if (readyHead == readyImages.size()) return;
+            imageIndex = readyImages[readyHead++];
+            if (readyHead == readyImages.size()) {
+                readyImages.clear();
+                readyHead = 0;
+            }
+        }
+
+        if (writeImage(images[imageIndex])) written++;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeImages.push_back(imageIndex);
+        }
+        cv.notify_all();
+    }
+}
+
+bool FrameCapture::writeImage(const Image& image) {
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%05d.ppm", image.frame);
+    framePath.resize(framePrefix);
+    framePath += name;
+    const std::string& path = framePath;
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", w, h);
+
+    // GL rows are bottom-up; PPM is top-down and RGB only.
+    unsigned char row[3 * 4096];
+    for (int y = h - 1; y >= 0; y--) {
+        const unsigned char* src = image.pixels.data() + static_cast<size_t>(y) * w * 4;
+        for (int x0 = 0; x0 < w; x0 += 4096) {
+            int count = std::min(w - x0, 4096);
+            for (int x = 0; x < count; x++) {
+                row[x * 3 + 0] = src[(x0 + x) * 4 + 0];
+                row[x * 3 + 1] = src[(x0 + x) * 4 + 1];
+                row[x * 3 + 2] = src[(x0 + x) * 4 + 2];
+            }
+            fwrite(row, 3, count, file);
+        }
+    }
+    fclose(file);
+    return true;
+}
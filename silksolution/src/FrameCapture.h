@@ -0,0 +1,75 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ==========================================
+// Offscreen Frame Capture
+// ==========================================
+// Renders into an FBO and reads frames back through a ring of pixel buffer
+// objects: frame N's glReadPixels is only mapped once frame N + ringSize - 1
+// has been submitted, so the copy overlaps rendering instead of stalling on
+// it. Mapped pixels are handed to a writer thread that encodes them as binary
+// PPM (outputDir/frame_00000.ppm, ...). Image memory is preallocated; the
+// render thread blocks only if the writer falls behind the whole pool.
+class FrameCapture {
+public:
+    FrameCapture(int width, int height, int ringSize, const std::string& outputDir);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    bool init();
+
+    // Binds the FBO and sets the viewport; draw the frame after this.
+    void beginFrame();
+    // Queues an async readback of the frame just drawn and retires the
+    // oldest readback in the ring if it is due.
+    void endFrame();
+    // Drains all pending readbacks and waits for the writer to finish.
+    void finish();
+
+    int width() const { return w; }
+    int height() const { return h; }
+    int framesWritten() const { return written; }
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = 0;
+        int frame = -1;
+    };
+    struct Image {
+        std::vector<unsigned char> pixels;
+        int frame = -1;
+    };
+
+    void retire(Slot& slot);
+    void writerLoop();
+    bool writeImage(const Image& image);
+
+    int w, h;
+    std::string outputDir;
+    std::string framePath; // writer thread only
+    size_t framePrefix = 0;
+
+    GLuint fbo = 0, colorRb = 0, depthRb = 0;
+    std::vector<Slot> ring;
+    int frameIndex = 0;
+
+    std::vector<Image> images;
+    std::vector<int> freeImages;
+    std::vector<int> readyImages; // FIFO, consumed from the front
+    size_t readyHead = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    int written = 0;
+    std::thread writer;
+};
@@ -0,0 +1,199 @@
+#include "FrameMemory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct alignas(64) PhaseCounter {
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+};
+
+std::atomic<bool> tracking{ false };
+std::atomic<int> framePhase{ PHASE_OTHER };
+PhaseCounter counters[PHASE_COUNT];
+thread_local int threadPhase = -1;
+
+const char* PHASE_NAMES[PHASE_COUNT] = { "other", "input", "simulate", "render", "capture" };
+
+void countAllocation(size_t size) {
+    if (!tracking.load(std::memory_order_relaxed)) return;
+    const int phase = threadPhase >= 0 ? threadPhase : framePhase.load(std::memory_order_relaxed);
+    counters[phase].allocations.fetch_add(1, std::memory_order_relaxed);
+    counters[phase].bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void* allocate(size_t size) {
+    countAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* allocateAligned(size_t size, size_t alignment) {
+    countAllocation(size);
+    size = std::max<size_t>((size + alignment - 1) / alignment * alignment, alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void freeAligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace
+
+// ------------------------------------------
+// Counting operator new / delete
+// ------------------------------------------
+void* operator new(size_t size) {
+    if (void* p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* p = allocateAligned(size, static_cast<size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    if (void* p = allocateAligned(size, static_cast<size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+
+// ------------------------------------------
+// Allocation tracking
+// ------------------------------------------
+void trackAllocations(bool enabled) {
+    tracking.store(enabled, std::memory_order_relaxed);
+}
+
+bool allocationsTracked() {
+    return tracking.load(std::memory_order_relaxed);
+}
+
+void resetAllocationCounts() {
+    for (PhaseCounter& c : counters) {
+        c.allocations.store(0, std::memory_order_relaxed);
+        c.bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+AllocationCounts allocationCounts(AllocationPhase phase) {
+    AllocationCounts counts;
+    counts.allocations = counters[phase].allocations.load(std::memory_order_relaxed);
+    counts.bytes = counters[phase].bytes.load(std::memory_order_relaxed);
+    return counts;
+}
+
+const char* allocationPhaseName(AllocationPhase phase) {
+    return PHASE_NAMES[phase];
+}
+
+void setAllocationPhase(AllocationPhase phase) {
+    framePhase.store(phase, std::memory_order_relaxed);
+}
+
+void setThreadAllocationPhase(AllocationPhase phase) {
+    threadPhase = phase;
+}
+
+uint64_t printAllocationCounts(int frames) {
+    frames = std::max(frames, 1);
+    uint64_t total = 0;
+    printf("%-10s %12s %14s %12s\n", "phase", "allocations", "bytes", "per frame");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        AllocationCounts counts = allocationCounts(static_cast<AllocationPhase>(i));
+        printf("%-10s %12llu %14llu %12.2f\n", PHASE_NAMES[i], static_cast<unsigned long long>(counts.allocations),
+            static_cast<unsigned long long>(counts.bytes), static_cast<double>(counts.allocations) / frames);
+        total += counts.allocations;
+    }
+    return total;
+}
+
+// ------------------------------------------
+// Frame scratch
+// ------------------------------------------
+FrameArena::FrameArena(size_t size) : blockSize(size) {
+}
+
+void* FrameArena::allocateBytes(size_t bytes, size_t alignment) {
+    // Blocks past the current one are left from earlier frames; skip any
+    // too small for this request
+    for (; current < blocks.size(); current++, offset = 0) {
+        Block& block = blocks[current];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        const size_t start = ((base + offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base;
+        if (start + bytes <= block.size) {
+            offset = start + bytes;
+            return block.data.get() + start;
+        }
+    }
+
+    Block block;
+    block.size = std::max(blockSize, bytes + alignment);
+    block.data.reset(new unsigned char[block.size]);
+    blocks.push_back(std::move(block));
+    current = blocks.size() - 1;
+    offset = 0;
+    return allocateBytes(bytes, alignment);
+}
+
+void FrameArena::rewind(Marker marker) {
+    current = marker.block;
+    offset = marker.offset;
+    if (current != 0 || offset != 0 || blocks.size() < 2) return;
+
+    // Empty again after outgrowing one block: next time, one will do
+    const size_t total = capacity();
+    blocks.clear();
+    Block block;
+    block.size = total;
+    block.data.reset(new unsigned char[total]);
+    blocks.push_back(std::move(block));
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
+
+FrameArena& scratchArena() {
+    thread_local FrameArena arena;
+    return arena;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ==========================================
+// Frame Memory
+// ==========================================
+// Allocation tracking: the program's operator new (FrameMemory.cpp) counts
+// allocations and bytes per frame phase while tracking is on. The frame
+// loop calls setAllocationPhase as it goes; an allocation on any thread
+// counts toward the phase the loop is in, so pool workers count toward the
+// step they help with, unless the thread set its own phase (the capture
+// writer). Every operator new in the process is seen, including those of
+// C++ drivers (llvmpipe's tessellator allocates on each patch draw), but
+// not malloc.
+//
+// Frame scratch: FrameArena hands out memory for per-frame temporaries
+// (packed vertices, tear candidates) by bumping an offset. ScratchScope
+// rewinds it on exit, so nested users stack like locals. The arena grows
+// while warming up; rewinding it to empty folds its blocks into one, so a
+// steady-state frame reuses it without touching the heap.
+enum AllocationPhase {
+    PHASE_OTHER,    // outside the frame loop
+    PHASE_INPUT,    // events, picking, dragging
+    PHASE_SIMULATE, // LOD selection, steps, tearing
+    PHASE_RENDER,   // culling, packing, draw calls
+    PHASE_CAPTURE,  // headless readback and image writing
+    PHASE_COUNT
+};
+
+struct AllocationCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+void trackAllocations(bool enabled);
+bool allocationsTracked();
+void resetAllocationCounts();
+AllocationCounts allocationCounts(AllocationPhase phase);
+const char* allocationPhaseName(AllocationPhase phase);
+// The phase the frame loop is in
+void setAllocationPhase(AllocationPhase phase);
+// Counts the calling thread's allocations toward phase from now on,
+// whatever the frame loop is doing.
+void setThreadAllocationPhase(AllocationPhase phase);
+
+// Prints the counts of every phase, per frame over frames frames. Returns
+// the total number of allocations.
+uint64_t printAllocationCounts(int frames);
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t blockSize = 1 << 20);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Uninitialized room for count objects of a trivial type T
+    template <class T>
+    T* allocate(size_t count) {
+        return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    struct Marker {
+        size_t block = 0, offset = 0;
+    };
+    Marker mark() const { return { current, offset }; }
+    // Frees everything allocated since marker was taken
+    void rewind(Marker marker);
+
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size = 0;
+    };
+
+    void* allocateBytes(size_t bytes, size_t alignment);
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0, offset = 0;
+};
+
+// The calling thread's scratch arena
+FrameArena& scratchArena();
+
+// Scratch memory that lives until the end of the enclosing scope
+class ScratchScope {
+public:
+    explicit ScratchScope(FrameArena& scratch = scratchArena()) : arena(scratch), marker(scratch.mark()) {}
+    ~ScratchScope() { arena.rewind(marker); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    template <class T>
+    T* allocate(size_t count) { return arena.allocate<T>(count); }
+
+private:
+    FrameArena& arena;
+    FrameArena::Marker marker;
+};
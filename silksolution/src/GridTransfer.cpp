@@ -0,0 +1,68 @@
+#include "GridTransfer.h"
+
+#include <cstddef>
+
+namespace {
+
+// Coarse samples along one axis: every other index plus the last one.
+std::vector<int> axisSamples(int n) {
+    std::vector<int> samples;
+    for (int i = 0; i < n; i += 2) samples.push_back(i);
+    if (samples.back() != n - 1) samples.push_back(n - 1);
+    return samples;
+}
+
+// For every fine index the bracketing coarse samples and the weight of the
+// upper one.
+void axisWeights(const std::vector<int>& samples, int n, std::vector<int>& lo, std::vector<int>& hi, std::vector<float>& t) {
+    lo.resize(n); hi.resize(n); t.resize(n);
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        while (k + 1 < (int)samples.size() && samples[k + 1] <= i) k++;
+        lo[i] = k;
+        if (samples[k] == i || k + 1 == (int)samples.size()) {
+            hi[i] = k;
+            t[i] = 0.0f;
+        }
+        else {
+            hi[i] = k + 1;
+            t[i] = (float)(i - samples[k]) / (float)(samples[k + 1] - samples[k]);
+        }
+    }
+}
+
+} // namespace
+
+GridTransfer::GridTransfer(int fineW, int fineH) : fineWidth(fineW), fineHeight(fineH) {
+    std::vector<int> sx = axisSamples(fineW);
+    std::vector<int> sy = axisSamples(fineH);
+    coarseWidth = (int)sx.size();
+    coarseHeight = (int)sy.size();
+
+    coarseToFine.resize(static_cast<size_t>(coarseWidth) * coarseHeight);
+    for (int y = 0; y < coarseHeight; y++) {
+        for (int x = 0; x < coarseWidth; x++) {
+            coarseToFine[y * coarseWidth + x] = sy[y] * fineW + sx[x];
+        }
+    }
+
+    std::vector<int> loX, hiX, loY, hiY;
+    std::vector<float> tX, tY;
+    axisWeights(sx, fineW, loX, hiX, tX);
+    axisWeights(sy, fineH, loY, hiY, tY);
+
+    prolongation.resize(static_cast<size_t>(fineW) * fineH);
+    for (int y = 0; y < fineH; y++) {
+        for (int x = 0; x < fineW; x++) {
+            Stencil& s = prolongation[y * fineW + x];
+            s.node[0] = loY[y] * coarseWidth + loX[x];
+            s.node[1] = loY[y] * coarseWidth + hiX[x];
+            s.node[2] = hiY[y] * coarseWidth + loX[x];
+            s.node[3] = hiY[y] * coarseWidth + hiX[x];
+            s.weight[0] = (1.0f - tX[x]) * (1.0f - tY[y]);
+            s.weight[1] = tX[x] * (1.0f - tY[y]);
+            s.weight[2] = (1.0f - tX[x]) * tY[y];
+            s.weight[3] = tX[x] * tY[y];
+        }
+    }
+}
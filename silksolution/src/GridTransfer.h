@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+// ==========================================
+// Grid Transfer
+// ==========================================
+// Index maps between a row-major fine grid and the coarse grid that keeps
+// every other row and column. The last row and column are always kept, so
+// the border (and with it the pinned top edge) survives coarsening of both
+// odd and even sizes.
+//   restriction   - injection: a coarse node copies its fine sample.
+//   prolongation  - bilinear: a fine node blends the coarse nodes around it;
+//                   nodes that are samples get weight 1 on themselves.
+class GridTransfer {
+public:
+    struct Stencil {
+        int node[4];
+        float weight[4];
+    };
+
+    GridTransfer(int fineW, int fineH);
+
+    static bool canCoarsen(int w, int h) { return w >= 3 && h >= 3; }
+
+    int fineWidth, fineHeight;
+    int coarseWidth, coarseHeight;
+
+    // Fine index of every coarse node.
+    std::vector<int> coarseToFine;
+    // Coarse interpolation stencil of every fine node.
+    std::vector<Stencil> prolongation;
+};
@@ -0,0 +1,188 @@
+#include "HeadlessContext.h"
+
+#include <GL/glew.h>
+
+// EGL unless OSMesa or GLFW alone was asked for, or on Windows unless asked for
+#if !defined(SILK_HEADLESS_OSMESA) && !defined(SILK_HEADLESS_GLFW) && (defined(SILK_HEADLESS_EGL) || !defined(_WIN32))
+#define HEADLESS_WITH_EGL 1
+#endif
+
+#if defined(HEADLESS_WITH_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#if defined(SILK_HEADLESS_OSMESA)
+#include <GL/osmesa.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+#include <iostream>
+
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+const char* HeadlessContext::backendName() const {
+    switch (backend) {
+    case EGL:    return "EGL surfaceless";
+    case OSMESA: return "OSMesa";
+    case GLFW:   return "hidden GLFW window";
+    default:     return "none";
+    }
+}
+
+bool HeadlessContext::create() {
+#if defined(SILK_HEADLESS_OSMESA)
+    return createOsmesa();
+#else
+#if defined(HEADLESS_WITH_EGL)
+    if (createEgl()) return true;
+    destroy();
+    std::cout << "EGL unavailable, falling back to a hidden GLFW window" << std::endl;
+#endif
+    return createGlfw();
+#endif
+}
+
+void HeadlessContext::destroy() {
+#if defined(HEADLESS_WITH_EGL)
+    if (display) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context) eglDestroyContext(display, context);
+        eglTerminate(display);
+        context = nullptr;
+    }
+    display = nullptr;
+#endif
+#if defined(SILK_HEADLESS_OSMESA)
+    if (context) OSMesaDestroyContext(static_cast<OSMesaContext>(context));
+#else
+    if (backend == GLFW && context) {
+        glfwDestroyWindow(static_cast<GLFWwindow*>(context));
+        glfwTerminate();
+    }
+#endif
+    context = nullptr;
+    backend = NONE;
+}
+
+bool HeadlessContext::initGlew() {
+    glewExperimental = GL_TRUE;
+    GLenum result = glewInit();
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+    // A GLX-built GLEW has loaded the GL entry points by the time it looks
+    // for an X display, which an EGL node doesn't have
+    if (result == GLEW_ERROR_NO_GLX_DISPLAY && backend == EGL) result = GLEW_OK;
+#endif
+    if (result != GLEW_OK) {
+        std::cout << "Failed to initialize GLEW: " << glewGetErrorString(result) << std::endl;
+        return false;
+    }
+    glGetError(); // glewInit can leave GL_INVALID_ENUM behind on core contexts
+    return true;
+}
+
+#if defined(HEADLESS_WITH_EGL)
+
+bool HeadlessContext::createEgl() {
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+        std::cout << "Failed to initialize EGL display" << std::endl;
+        return false;
+    }
+    display = dpy;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "EGL has no desktop OpenGL support" << std::endl;
+        return false;
+    }
+
+    const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = NULL;
+    EGLint numConfigs = 0;
+    eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    // Surfaceless platforms may expose no configs at all (EGL_KHR_no_config_context).
+    EGLContext ctx = eglCreateContext(dpy, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT) {
+        std::cout << "Failed to create EGL context" << std::endl;
+        return false;
+    }
+    context = ctx;
+
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        std::cout << "Failed to make EGL context current (EGL_KHR_surfaceless_context missing?)" << std::endl;
+        return false;
+    }
+    backend = EGL;
+    return true;
+}
+
+#endif
+
+#if defined(SILK_HEADLESS_OSMESA)
+
+bool HeadlessContext::createOsmesa() {
+    const int attribs[] = {
+        OSMESA_FORMAT, OSMESA_RGBA,
+        OSMESA_DEPTH_BITS, 24,
+        OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+    OSMesaContext ctx = OSMesaCreateContextAttribs(attribs, NULL);
+    if (!ctx) {
+        std::cout << "Failed to create OSMesa context" << std::endl;
+        return false;
+    }
+    context = ctx;
+    backend = OSMESA;
+
+    // The OSMesa color buffer is never drawn to; a 1x1 surface is enough to bind.
+    if (!OSMesaMakeCurrent(ctx, dummyBuffer, GL_UNSIGNED_BYTE, 1, 1)) {
+        std::cout << "Failed to make OSMesa context current" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool HeadlessContext::createGlfw() {
+    if (!glfwInit()) {
+        std::cout << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(1, 1, "Silk Simulation - Headless", NULL, NULL);
+    if (window == NULL) {
+        std::cout << "Failed to create hidden GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    context = window;
+    backend = GLFW;
+    glfwMakeContextCurrent(window);
+    return true;
+}
+
+#endif
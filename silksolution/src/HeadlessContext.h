@@ -0,0 +1,49 @@
+#pragma once
+
+// ==========================================
+// Headless GL Context
+// ==========================================
+// Creates a GL 3.3 core context with no visible window for offscreen rendering.
+// Backends:
+//   EGL surfaceless - the default on non-Windows builds (or SILK_HEADLESS_EGL):
+//                     needs no display server (Mesa llvmpipe / GPU render
+//                     nodes). If it fails, create() falls back to GLFW.
+//   hidden GLFW     - the only backend on Windows, e.g. with Mesa's
+//                     opengl32.dll dropped next to the executable on GPU-less
+//                     nodes, and the fallback elsewhere. Needs a display.
+//                     SILK_HEADLESS_GLFW builds with this one only (no libEGL).
+//   OSMesa          - SILK_HEADLESS_OSMESA, instead of both; GLEW must be
+//                     built with GLEW_OSMESA.
+// GLEW needs no special build for EGL: a stock (GLX) GLEW loads the GL entry
+// points through libglvnd, then reports GLEW_ERROR_NO_GLX_DISPLAY for its
+// GLX half when there is no X display, which initGlew() accepts on EGL. A
+// GLEW built with GLEW_EGL works as well.
+// All rendering goes to an FBO, so the default framebuffer is never used.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Creates the context and makes it current.
+    bool create();
+    void destroy();
+    // glewInit for the current context; false (with a message) on failure.
+    bool initGlew();
+
+    const char* backendName() const;
+
+private:
+    enum Backend { NONE, EGL, OSMESA, GLFW };
+
+    bool createEgl();
+    bool createOsmesa();
+    bool createGlfw();
+
+    Backend backend = NONE;
+    void* display = nullptr; // EGLDisplay / unused / unused
+    void* context = nullptr; // EGLContext / OSMesaContext / GLFWwindow*
+    unsigned char dummyBuffer[4] = {};
+};
@@ -0,0 +1,328 @@
+#include "KernelBench.h"
+
+#include "Cloth.h"
+#include "TaskPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const float BENCH_STEP = 0.01f;
+const int HANG_STEPS = 100;
+const glm::vec3 BENCH_WIND(1.0f, 0.0f, 3.0f);
+// The app's window and start camera, for picking
+const int VIEW_WIDTH = 1280, VIEW_HEIGHT = 720;
+const glm::vec3 VIEW_POSITION(0.0f, 3.0f, 12.0f);
+// The longest repetition calibration will try, in calls
+const int MAX_CALLS = 1 << 20;
+
+struct CaseResult {
+    std::string kernel;
+    int size = 0, threads = 0;
+    int calls = 0;
+    double medianNs = 0.0, madNs = 0.0;
+};
+
+double median(std::vector<double> values) {
+    const size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    if (values.size() % 2) return values[mid];
+    const double upper = values[mid];
+    return (upper + *std::max_element(values.begin(), values.begin() + mid)) * 0.5;
+}
+
+// Times body, reset() putting the state back before every repetition
+template <class Body, class Reset>
+CaseResult measure(const KernelBenchOptions& opts, const Body& body, const Reset& reset) {
+    reset();
+    for (int i = 0; i < opts.warmup; i++) body();
+
+    auto timeCalls = [&](int calls) {
+        reset();
+        auto start = Clock::now();
+        for (int i = 0; i < calls; i++) body();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    // Double the calls until one repetition is long enough to time
+    CaseResult result;
+    result.calls = 1;
+    while (result.calls < MAX_CALLS && timeCalls(result.calls) < opts.minRepetitionMs * 1e6) result.calls *= 2;
+
+    std::vector<double> perCall(opts.repetitions);
+    for (double& t : perCall) t = timeCalls(result.calls) / result.calls;
+    result.medianNs = median(perCall);
+    for (double& t : perCall) t = std::abs(t - result.medianNs);
+    result.madNs = median(perCall);
+    return result;
+}
+
+// One family's links in the cloth's color buckets: bucket c is
+// [offsets[c], offsets[c + 1]), and shares no particle below
+// parallelColorCount. The copies point into the cloth's particles.
+struct FamilySweep {
+    std::vector<Constraint> links;
+    std::vector<size_t> offsets;
+    int parallelColorCount = 0;
+};
+
+FamilySweep familySweep(const Cloth& cloth, ConstraintType type) {
+    FamilySweep sweep;
+    sweep.offsets.push_back(0);
+    for (size_t c = 0; c + 1 < cloth.colorOffsets.size(); c++) {
+        for (size_t k = cloth.colorOffsets[c]; k < cloth.colorOffsets[c + 1]; k++) {
+            if (cloth.constraints[k].type == type) sweep.links.push_back(cloth.constraints[k]);
+        }
+        sweep.offsets.push_back(sweep.links.size());
+    }
+    sweep.parallelColorCount = cloth.parallelColorCount;
+    return sweep;
+}
+
+// One constraint iteration of Cloth::update over the family
+void solveSweep(FamilySweep& sweep, TaskPool* pool) {
+    for (size_t c = 0; c + 1 < sweep.offsets.size(); c++) {
+        Constraint* bucket = sweep.links.data() + sweep.offsets[c];
+        int count = static_cast<int>(sweep.offsets[c + 1] - sweep.offsets[c]);
+        if (!pool || static_cast<int>(c) >= sweep.parallelColorCount) {
+            for (int k = 0; k < count; k++) bucket[k].solve();
+            continue;
+        }
+        pool->parallelFor(count, PARALLEL_GRAIN, [bucket](int begin, int end) {
+            for (int k = begin; k < end; k++) bucket[k].solve();
+        });
+    }
+}
+
+// Runs every kernel on one cloth and pool; threads == 1 runs serially
+void benchCloth(const KernelBenchOptions& opts, PickFunction pick, int size, TaskPool& pool,
+    std::vector<CaseResult>& results) {
+    const int threads = pool.threadCount();
+    TaskPool* workers = threads > 1 ? &pool : nullptr;
+
+    Cloth cloth(size, size);
+    for (int i = 0; i < HANG_STEPS; i++) cloth.update(BENCH_STEP, BENCH_WIND, workers);
+    const std::vector<Particle> hanging = cloth.particles;
+    auto restore = [&]() { std::copy(hanging.begin(), hanging.end(), cloth.particles.begin()); };
+    auto keep = []() {};
+
+    auto run = [&](const char* kernel, bool serial, const auto& body, const auto& reset) {
+        if (serial && threads > 1) return;
+        if (!opts.filter.empty() && std::string(kernel).find(opts.filter) == std::string::npos) return;
+        CaseResult result = measure(opts, body, reset);
+        result.kernel = kernel;
+        result.size = size;
+        result.threads = threads;
+        results.push_back(result);
+        printf("%-17s %5d %7d %8d %12.2f %7.2f%%\n", kernel, size, threads, result.calls, result.medianNs / 1000.0,
+            result.medianNs > 0.0 ? 100.0 * result.madNs / result.medianNs : 0.0);
+        fflush(stdout);
+    };
+
+    const int count = static_cast<int>(cloth.particles.size());
+    const float damping = cloth.params.damping;
+    run("integrate", false, [&]() {
+        if (workers) {
+            workers->parallelFor(count, PARALLEL_GRAIN, [&](int begin, int end) {
+                cloth.integrate(begin, end, BENCH_STEP, damping, 1.0f, BENCH_WIND);
+            });
+        }
+        else {
+            cloth.integrate(0, count, BENCH_STEP, damping, 1.0f, BENCH_WIND);
+        }
+    }, restore);
+
+    const char* families[] = { "solve_structural", "solve_shear", "solve_bending" };
+    const ConstraintType types[] = { STRUCTURAL, SHEAR, BENDING };
+    for (int f = 0; f < 3; f++) {
+        FamilySweep sweep = familySweep(cloth, types[f]);
+        run(families[f], false, [&]() { solveSweep(sweep, workers); }, restore);
+    }
+
+    run("normals", false, [&]() { cloth.recalculateNormals(workers); }, keep);
+
+    std::vector<float> packed(cloth.particles.size() * 11);
+    run("pack_vertices", true, [&]() { cloth.packVertices(0, cloth.particles.size(), packed.data()); }, keep);
+
+    const glm::mat4 view = glm::lookAt(VIEW_POSITION, VIEW_POSITION + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)VIEW_WIDTH / (float)VIEW_HEIGHT, 0.1f, 100.0f);
+    run("pick", true, [&]() { pick(VIEW_WIDTH / 2.0, VIEW_HEIGHT / 2.0, cloth, view, projection, VIEW_WIDTH, VIEW_HEIGHT, nullptr); }, keep);
+
+    run("step", false, [&]() { cloth.update(BENCH_STEP, BENCH_WIND, workers); }, restore);
+}
+
+bool writeResults(const std::string& path, const KernelBenchOptions& opts, const std::vector<CaseResult>& results) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        std::cout << "Failed to write benchmark results: " << path << std::endl;
+        return false;
+    }
+    fprintf(file, "{\n  \"suite\": \"silksolution-kernels\",\n  \"warmup\": %d,\n  \"repetitions\": %d,\n", opts.warmup, opts.repetitions);
+    fprintf(file, "  \"min_repetition_ms\": %.3f,\n  \"hardware_threads\": %u,\n  \"results\": [\n",
+        opts.minRepetitionMs, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); i++) {
+        const CaseResult& r = results[i];
+        fprintf(file, "    { \"kernel\": \"%s\", \"size\": %d, \"threads\": %d, \"calls\": %d, \"median_ns\": %.1f, \"mad_ns\": %.1f }%s\n",
+            r.kernel.c_str(), r.size, r.threads, r.calls, r.medianNs, r.madNs, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    std::cout << "Wrote " << results.size() << " cases to " << path << std::endl;
+    return true;
+}
+
+// The value after "key": on a line, unquoted
+bool readField(const std::string& line, const char* key, std::string& value) {
+    const std::string quoted = std::string("\"") + key + "\"";
+    size_t at = line.find(quoted);
+    if (at == std::string::npos) return false;
+    at = line.find(':', at + quoted.size());
+    if (at == std::string::npos) return false;
+    at = line.find_first_not_of(" \t", at + 1);
+    if (at == std::string::npos) return false;
+    if (line[at] == '"') {
+        const size_t end = line.find('"', at + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(at + 1, end - at - 1);
+        return true;
+    }
+    const size_t end = line.find_first_of(",} \t", at);
+    value = line.substr(at, end == std::string::npos ? std::string::npos : end - at);
+    return !value.empty();
+}
+
+// Reads the one-case-per-line results writeResults produces
+bool loadResults(const std::string& path, std::vector<CaseResult>& results) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Failed to open benchmark results: " << path << std::endl;
+        return false;
+    }
+    std::string line, size, threads, calls, medianNs, madNs;
+    CaseResult result;
+    while (std::getline(file, line)) {
+        if (!readField(line, "kernel", result.kernel)) continue;
+        if (!readField(line, "size", size) || !readField(line, "threads", threads) || !readField(line, "calls", calls) ||
+            !readField(line, "median_ns", medianNs) || !readField(line, "mad_ns", madNs)) {
+            std::cout << "Malformed benchmark result in " << path << ": " << line << std::endl;
+            return false;
+        }
+        result.size = atoi(size.c_str());
+        result.threads = atoi(threads.c_str());
+        result.calls = atoi(calls.c_str());
+        result.medianNs = atof(medianNs.c_str());
+        result.madNs = atof(madNs.c_str());
+        results.push_back(result);
+    }
+    if (results.empty()) {
+        std::cout << "No benchmark results in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string caseKey(const CaseResult& r) {
+    std::ostringstream key;
+    key << r.kernel << '/' << r.size << '/' << r.threads;
+    return key.str();
+}
+
+int compareResults(const std::vector<CaseResult>& current, const std::vector<CaseResult>& baseline, double threshold) {
+    std::map<std::string, const CaseResult*> before;
+    for (const CaseResult& r : baseline) before[caseKey(r)] = &r;
+
+    int slower = 0, compared = 0;
+    printf("%-17s %5s %7s %12s %12s %8s\n", "kernel", "size", "threads", "base us", "now us", "change");
+    for (const CaseResult& now : current) {
+        auto found = before.find(caseKey(now));
+        if (found == before.end()) {
+            printf("%-17s %5d %7d %12s %12.2f %8s  new\n", now.kernel.c_str(), now.size, now.threads, "-", now.medianNs / 1000.0, "");
+            continue;
+        }
+        const CaseResult& base = *found->second;
+        before.erase(found);
+        compared++;
+
+        const double change = base.medianNs > 0.0 ? 100.0 * (now.medianNs - base.medianNs) / base.medianNs : 0.0;
+        const double noise = 3.0 * (base.madNs + now.madNs);
+        const char* status = "";
+        if (change > threshold && now.medianNs - base.medianNs > noise) {
+            status = "SLOWER";
+            slower++;
+        }
+        else if (change < -threshold && base.medianNs - now.medianNs > noise) {
+            status = "faster";
+        }
+        printf("%-17s %5d %7d %12.2f %12.2f %+7.1f%%  %s\n", now.kernel.c_str(), now.size, now.threads,
+            base.medianNs / 1000.0, now.medianNs / 1000.0, change, status);
+    }
+    for (const CaseResult& base : baseline) {
+        if (before.count(caseKey(base))) {
+            printf("%-17s %5d %7d %12.2f %12s %8s  missing\n", base.kernel.c_str(), base.size, base.threads, base.medianNs / 1000.0, "-", "");
+        }
+    }
+
+    std::cout << slower << " of " << compared << " cases slower than the baseline by more than " << threshold << "%" << std::endl;
+    return slower > 0 ? -1 : 0;
+}
+
+} // namespace
+
+bool parseIntList(const std::string& text, std::vector<int>& values) {
+    values.clear();
+    std::istringstream stream(text);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        char* end = nullptr;
+        const long value = strtol(entry.c_str(), &end, 10);
+        if (entry.empty() || *end != '\0' || value <= 0) return false;
+        values.push_back(static_cast<int>(value));
+    }
+    return !values.empty();
+}
+
+int runKernelBenchmarks(const KernelBenchOptions& opts, PickFunction pick) {
+    std::vector<int> threadCounts = opts.threadCounts;
+    if (threadCounts.empty()) {
+        threadCounts.push_back(1);
+        const int cores = static_cast<int>(std::thread::hardware_concurrency());
+        if (cores > 1) threadCounts.push_back(cores);
+    }
+
+    std::vector<CaseResult> results;
+    printf("%-17s %5s %7s %8s %12s %8s\n", "kernel", "size", "threads", "calls", "median us", "MAD");
+    for (int threads : threadCounts) {
+        TaskPool pool(threads);
+        for (int size : opts.sizes) benchCloth(opts, pick, std::max(size, 2), pool, results);
+    }
+    if (results.empty()) {
+        std::cout << "No kernel matches --filter " << opts.filter << std::endl;
+        return -1;
+    }
+
+    if (!opts.outputFile.empty() && !writeResults(opts.outputFile, opts, results)) return -1;
+    if (opts.baselineFile.empty()) return 0;
+
+    std::vector<CaseResult> baseline;
+    if (!loadResults(opts.baselineFile, baseline)) return -1;
+    return compareResults(results, baseline, opts.threshold);
+}
+
+int compareKernelBenchmarks(const std::string& currentFile, const std::string& baselineFile, double threshold) {
+    std::vector<CaseResult> current, baseline;
+    if (!loadResults(currentFile, current) || !loadResults(baselineFile, baseline)) return -1;
+    return compareResults(current, baseline, threshold);
+}
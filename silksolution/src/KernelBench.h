@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class Cloth;
+
+// ==========================================
+// Kernel Microbenchmarks
+// ==========================================
+// Times each hot loop of a frame on its own, on square grid cloths of a few
+// sizes and pools of a few thread counts (no GL):
+//   integrate         forces and Particle::update over every particle
+//   solve_structural  one Constraint::solve sweep over one family's links,
+//   solve_shear       color by color like Cloth::update
+//   solve_bending
+//   normals           Cloth::recalculateNormals
+//   pack_vertices     the 11-float VBO packing of Cloth::draw, every particle
+//   pick              getParticleIndexUnderCursor from the app's start camera
+//   step              a whole Cloth::update
+// The cloths hang for a second first, so the loops see a folded, moving
+// state. integrate and the sweeps split over the pool at every size; normals
+// and step go through Cloth, which keeps cloths under PARALLEL_MIN_PARTICLES
+// on one thread. pack_vertices and pick are serial and run once per size.
+//
+// Each case is called a few times to warm up, then timed in repetitions of
+// enough calls to last minRepetitionMs; the state is restored between
+// repetitions, outside the clock. A case reports the median time per call
+// and the median absolute deviation (MAD) over the repetitions.
+//
+// Results are JSON, one case per line:
+//   { "kernel": "normals", "size": 128, "threads": 1, "calls": 16, "median_ns": 412034.5, "mad_ns": 2210.0 }
+// compareKernelBenchmarks flags a case as a regression when its median is
+// more than threshold percent over the baseline's and the difference is
+// more than three times the two MADs together, so noise alone doesn't.
+// Baselines only compare on the machine that recorded them.
+struct KernelBenchOptions {
+    std::string outputFile;   // JSON results; empty prints the table only
+    std::string baselineFile; // compared after the run when set
+    std::vector<int> sizes = { 32, 64, 128, 256 };
+    std::vector<int> threadCounts; // empty = 1 and all cores
+    int warmup = 3;
+    int repetitions = 15;
+    double minRepetitionMs = 2.0;
+    double threshold = 10.0; // percent
+    std::string filter;      // only kernels whose name contains this
+};
+
+// getParticleIndexUnderCursor's signature
+typedef int (*PickFunction)(double xpos, double ypos, const Cloth& cloth, const glm::mat4& view,
+    const glm::mat4& projection, int width, int height, float* distanceSq);
+
+// silksolution --kernel-bench FILE [--baseline FILE] [--threshold PCT] [--sizes 32,64]
+//                             [--thread-counts 1,4] [--reps N] [--filter TEXT]
+// Returns -1 on a regression against the baseline.
+int runKernelBenchmarks(const KernelBenchOptions& opts, PickFunction pick);
+
+// silksolution --bench-compare FILE --baseline FILE [--threshold PCT]
+// Prints every case of both files side by side; -1 if any got slower.
+int compareKernelBenchmarks(const std::string& currentFile, const std::string& baselineFile, double threshold);
+
+// "32,64,128" -> { 32, 64, 128 }; false unless every entry is a positive number
+bool parseIntList(const std::string& text, std::vector<int>& values);
@@ -0,0 +1,335 @@
+#include "MeshOrder.h"
+
+#include "Cloth.h"
+#include "ObjImport.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <utility>
+
+namespace {
+
+// Bits per axis of the Hilbert cube; three of them leave 32 bits of the sort
+// key for the vertex number.
+const int HILBERT_BITS = 10;
+
+// Forsyth's scoring: recently used vertices score high, the three of the last
+// triangle a little less (so strips don't just zig-zag), and vertices with few
+// triangles left get a boost so they are finished off instead of stranded.
+const int MAX_CACHE_SIZE = 64;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+const unsigned int VALENCE_TABLE_SIZE = 32;
+
+// Skilling's transform from axes to the transposed Hilbert index, then the
+// index bits interleaved most significant first.
+uint32_t hilbertIndex(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t axes[3] = { x, y, z };
+    const uint32_t top = 1u << (HILBERT_BITS - 1);
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        uint32_t p = q - 1;
+        for (int i = 0; i < 3; i++) {
+            if (axes[i] & q) {
+                axes[0] ^= p;
+            }
+            else {
+                uint32_t t = (axes[0] ^ axes[i]) & p;
+                axes[0] ^= t;
+                axes[i] ^= t;
+            }
+        }
+    }
+    axes[1] ^= axes[0];
+    axes[2] ^= axes[1];
+    uint32_t t = 0;
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        if (axes[2] & q) t ^= q - 1;
+    }
+    for (int i = 0; i < 3; i++) axes[i] ^= t;
+
+    uint32_t index = 0;
+    for (int bit = HILBERT_BITS - 1; bit >= 0; bit--) {
+        for (int i = 0; i < 3; i++) index = (index << 1) | ((axes[i] >> bit) & 1);
+    }
+    return index;
+}
+
+// LRU model of a 32 KiB, 8-way L1 data cache with 64 byte lines
+class CacheModel {
+public:
+    void touch(const void* address) {
+        uint64_t line = (reinterpret_cast<uintptr_t>(address) >> 6) + 1; // 0 = empty way
+        uint64_t* set = &tags[(line % SETS) * WAYS];
+        for (int w = 0; w < WAYS; w++) {
+            if (set[w] == line) {
+                std::rotate(set, set + w, set + w + 1);
+                return;
+            }
+        }
+        misses++;
+        std::copy_backward(set, set + WAYS - 1, set + WAYS);
+        set[0] = line;
+    }
+    // A particle spans two lines at most: its first and last byte.
+    void touchParticle(const Particle& p) {
+        touch(&p);
+        touch(reinterpret_cast<const char*>(&p + 1) - 1);
+    }
+
+    size_t misses = 0;
+
+private:
+    static const int SETS = 64;
+    static const int WAYS = 8;
+    uint64_t tags[SETS * WAYS] = {};
+};
+
+struct LayoutStats {
+    double buildSeconds = 0.0;
+    float missRatio = 0.0f;
+    double missesPerConstraint = 0.0;
+    double missesPerTriangle = 0.0;
+    double stepMs = 0.0;
+    double normalsMs = 0.0;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+LayoutStats measureLayout(const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& uvs,
+    const std::vector<unsigned int>& triangles, bool reorder, TaskPool& pool, size_t* constraintCount) {
+    const int STEPS = 10;
+    const glm::vec3 WIND(1.0f, 0.0f, 3.0f);
+    LayoutStats stats;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Particle> particles;
+    particles.reserve(positions.size());
+    // Pinned along the top edge like an imported garment, so it hangs
+    float top = -FLT_MAX, bottom = FLT_MAX;
+    for (const glm::vec3& p : positions) {
+        top = std::max(top, p.y);
+        bottom = std::min(bottom, p.y);
+    }
+    for (size_t i = 0; i < positions.size(); i++) {
+        particles.emplace_back(positions[i], uvs[i]);
+        particles.back().isPinned = positions[i].y >= top - 0.01f * (top - bottom);
+    }
+    ClothParams params;
+    params.reorderMesh = reorder;
+    Cloth cloth(std::move(particles), triangles, params, &pool);
+    stats.buildSeconds = secondsSince(start);
+    *constraintCount = cloth.constraints.size();
+
+    stats.missRatio = vertexCacheMissRatio(cloth.indices, cloth.particles.size());
+    CacheModel solve;
+    for (const Constraint& c : cloth.constraints) {
+        solve.touchParticle(*c.p1);
+        solve.touchParticle(*c.p2);
+    }
+    stats.missesPerConstraint = double(solve.misses) / std::max<size_t>(1, cloth.constraints.size());
+    CacheModel normals;
+    for (unsigned int index : cloth.indices) normals.touchParticle(cloth.particles[index]);
+    stats.missesPerTriangle = double(normals.misses) / std::max<size_t>(1, cloth.indices.size() / 3);
+
+    cloth.update(0.01f, WIND, &pool);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < STEPS; i++) cloth.update(0.01f, WIND, &pool);
+    stats.stepMs = secondsSince(start) * 1000.0 / STEPS;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < STEPS; i++) cloth.recalculateNormals(&pool);
+    stats.normalsMs = secondsSince(start) * 1000.0 / STEPS;
+    return stats;
+}
+
+} // namespace
+
+std::vector<unsigned int> hilbertOrder(const std::vector<glm::vec3>& points) {
+    glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    for (const glm::vec3& p : points) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    // One cube for all axes, so the curve isn't stretched along a flat side
+    glm::vec3 size = hi - lo;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+    const float cells = float((1u << HILBERT_BITS) - 1);
+    float scale = extent > 0.0f ? cells / extent : 0.0f;
+
+    std::vector<uint64_t> keys(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        glm::vec3 cell = glm::clamp((points[i] - lo) * scale, 0.0f, cells);
+        uint32_t h = hilbertIndex(uint32_t(cell.x), uint32_t(cell.y), uint32_t(cell.z));
+        keys[i] = (uint64_t(h) << 32) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<unsigned int> order(points.size());
+    for (size_t i = 0; i < keys.size(); i++) order[i] = static_cast<unsigned int>(keys[i]);
+    return order;
+}
+
+void optimizeTriangleOrder(std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+    cacheSize = std::clamp(cacheSize, 4, MAX_CACHE_SIZE);
+
+    float cacheScore[MAX_CACHE_SIZE];
+    for (int i = 0; i < cacheSize; i++) {
+        cacheScore[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - float(i - 3) / (cacheSize - 3), CACHE_DECAY_POWER);
+    }
+    float valenceScore[VALENCE_TABLE_SIZE] = { 0.0f };
+    for (unsigned int i = 1; i < VALENCE_TABLE_SIZE; i++) {
+        valenceScore[i] = VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+    }
+    auto score = [&](int slot, unsigned int remaining) {
+        if (remaining == 0) return -1.0f;
+        return (slot >= 0 ? cacheScore[slot] : 0.0f) + valenceScore[std::min(remaining, VALENCE_TABLE_SIZE - 1)];
+    };
+
+    // Triangles not yet emitted around each vertex: adjacent[first[v], first[v] + remaining[v])
+    std::vector<unsigned int> remaining(vertexCount, 0), first(vertexCount + 1, 0);
+    for (unsigned int v : indices) remaining[v]++;
+    for (size_t v = 0; v < vertexCount; v++) first[v + 1] = first[v] + remaining[v];
+    std::vector<unsigned int> adjacent(indices.size());
+    {
+        std::vector<unsigned int> cursor(first.begin(), first.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) adjacent[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<int> slot(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = score(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+    }
+    std::vector<char> emitted(triangleCount, 0);
+
+    std::vector<unsigned int> ordered;
+    ordered.reserve(indices.size());
+    unsigned int cache[MAX_CACHE_SIZE + 3];
+    int cached = 0;
+    size_t nextInput = 0; // restart point once nothing in the cache has triangles left
+    size_t best = 0;
+    while (ordered.size() < indices.size()) {
+        if (best == triangleCount) {
+            while (emitted[nextInput]) nextInput++;
+            best = nextInput;
+        }
+        emitted[best] = 1;
+        const unsigned int* corner = &indices[3 * best];
+        ordered.insert(ordered.end(), corner, corner + 3);
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = corner[k];
+            unsigned int* fan = &adjacent[first[v]];
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                if (fan[j] == best) {
+                    fan[j] = fan[--remaining[v]];
+                    break;
+                }
+            }
+        }
+
+        // The triangle's corners move to the front; whatever is pushed past
+        // the end falls out and is rescored with the rest.
+        unsigned int next[MAX_CACHE_SIZE + 3];
+        int count = 0;
+        for (int k = 0; k < 3; k++) next[count++] = corner[k];
+        for (int i = 0; i < cached; i++) {
+            if (cache[i] != corner[0] && cache[i] != corner[1] && cache[i] != corner[2]) next[count++] = cache[i];
+        }
+        for (int i = 0; i < count; i++) {
+            unsigned int v = next[i];
+            slot[v] = i < cacheSize ? i : -1;
+            float updated = score(slot[v], remaining[v]);
+            float delta = updated - vertexScore[v];
+            vertexScore[v] = updated;
+            for (unsigned int j = 0; j < remaining[v]; j++) triangleScore[adjacent[first[v] + j]] += delta;
+        }
+        cached = std::min(count, cacheSize);
+        for (int i = 0; i < cached; i++) cache[i] = next[i];
+
+        best = triangleCount;
+        float bestScore = -FLT_MAX;
+        for (int i = 0; i < cached; i++) {
+            unsigned int v = cache[i];
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                unsigned int t = adjacent[first[v] + j];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    indices.swap(ordered);
+}
+
+float vertexCacheMissRatio(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize) {
+    if (indices.size() < 3) return 0.0f;
+    // A vertex is still cached while fewer than cacheSize misses followed its own
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (unsigned int v : indices) {
+        if (insertedAt[v] == 0 || misses - insertedAt[v] >= static_cast<size_t>(cacheSize)) {
+            insertedAt[v] = ++misses;
+        }
+    }
+    return float(misses) / (indices.size() / 3);
+}
+
+int runLayoutBenchmark(const std::string& objPath, int threads) {
+    TaskPool pool(threads);
+    ObjMesh mesh;
+    if (!loadObj(objPath, mesh, &pool)) return -1;
+
+    // The exporter's worst case: vertices and triangles in random order
+    const size_t vertexCount = mesh.positions.size();
+    std::mt19937 random(1234);
+    std::vector<unsigned int> shuffle(vertexCount), remap(vertexCount);
+    std::iota(shuffle.begin(), shuffle.end(), 0u);
+    std::shuffle(shuffle.begin(), shuffle.end(), random);
+    std::vector<glm::vec3> shuffledPositions(vertexCount);
+    std::vector<glm::vec2> shuffledUvs(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        shuffledPositions[i] = mesh.positions[shuffle[i]];
+        shuffledUvs[i] = mesh.uvs[shuffle[i]];
+        remap[shuffle[i]] = static_cast<unsigned int>(i);
+    }
+    std::vector<unsigned int> triangleOrder(mesh.indices.size() / 3);
+    std::iota(triangleOrder.begin(), triangleOrder.end(), 0u);
+    std::shuffle(triangleOrder.begin(), triangleOrder.end(), random);
+    std::vector<unsigned int> shuffledIndices;
+    shuffledIndices.reserve(mesh.indices.size());
+    for (unsigned int t : triangleOrder) {
+        for (int k = 0; k < 3; k++) shuffledIndices.push_back(remap[mesh.indices[3 * t + k]]);
+    }
+
+    size_t constraintCount = 0;
+    const char* names[] = { "file", "shuffled", "reordered" };
+    LayoutStats stats[3];
+    stats[0] = measureLayout(mesh.positions, mesh.uvs, mesh.indices, false, pool, &constraintCount);
+    stats[1] = measureLayout(shuffledPositions, shuffledUvs, shuffledIndices, false, pool, &constraintCount);
+    stats[2] = measureLayout(shuffledPositions, shuffledUvs, shuffledIndices, true, pool, &constraintCount);
+
+    std::cout << objPath << ": " << vertexCount << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+        << constraintCount << " constraints on " << pool.threadCount() << " threads" << std::endl;
+    printf("%-10s %8s %6s %12s %12s %9s %11s\n", "layout", "build s", "ACMR", "L1 miss/con", "L1 miss/tri", "step ms", "normals ms");
+    for (int i = 0; i < 3; i++) {
+        printf("%-10s %8.3f %6.3f %12.3f %12.3f %9.2f %11.2f\n", names[i], stats[i].buildSeconds, stats[i].missRatio,
+            stats[i].missesPerConstraint, stats[i].missesPerTriangle, stats[i].stepMs, stats[i].normalsMs);
+    }
+    return 0;
+}
@@ -0,0 +1,354 @@
+#include "ObjImport.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const unsigned int NO_UV = ~0u;
+// Chunks per pool thread, so an uneven file still spreads out
+const int CHUNKS_PER_THREAD = 4;
+const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+// Read-only view of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return;
+    bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (bytes) length = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(view);
+            length = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (bytes) munmap(const_cast<char*>(bytes), length);
+}
+#endif
+
+// A run of whole lines. The first pass fills in the counts; the second
+// writes from the first* offsets, the sums of the counts before it.
+struct Chunk {
+    const char* begin;
+    const char* end;
+    size_t positions = 0, uvs = 0, triangles = 0;
+    size_t firstPosition = 0, firstUV = 0, firstTriangle = 0;
+    bool bad = false;
+};
+
+// Where the second pass writes; null during the first
+struct Output {
+    glm::vec3* positions = nullptr;
+    glm::vec2* uvs = nullptr;
+    unsigned int* corners = nullptr;   // 3 position indices per triangle
+    unsigned int* cornerUVs = nullptr; // 3 uv indices per triangle
+    size_t positionCount = 0, uvCount = 0;
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+
+inline const char* parseFloats(const char* p, const char* end, float* values, int count, bool& ok) {
+    for (int i = 0; i < count; i++) {
+        p = skipBlanks(p, end);
+        std::from_chars_result r = std::from_chars(p, end, values[i]);
+        if (r.ec != std::errc()) {
+            ok = false;
+            return p;
+        }
+        p = r.ptr;
+    }
+    return p;
+}
+
+// 1-based or negative (relative to seen) OBJ index to 0-based; ~0u if out of range
+inline unsigned int resolveIndex(long long index, size_t seen, size_t total) {
+    long long resolved = index > 0 ? index - 1 : static_cast<long long>(seen) + index;
+    return resolved >= 0 && resolved < static_cast<long long>(total) ? static_cast<unsigned int>(resolved) : ~0u;
+}
+
+void parseChunk(Chunk& chunk, const Output& out) {
+    const bool write = out.positions != nullptr;
+    size_t positions = 0, uvs = 0, triangles = 0;
+
+    for (const char* line = chunk.begin; line < chunk.end;) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', chunk.end - line));
+        if (!lineEnd) lineEnd = chunk.end;
+        const char* p = skipBlanks(line, lineEnd);
+        line = lineEnd + 1;
+        const int keyword = p + 1 < lineEnd && p[0] == 'v' && p[1] == 't' ? 2 : 1;
+        if (p + keyword >= lineEnd || !isBlank(p[keyword])) continue;
+
+        if (p[0] == 'v' && keyword == 1) {
+            if (write) {
+                float xyz[3];
+                bool ok = true;
+                parseFloats(p + 1, lineEnd, xyz, 3, ok);
+                if (!ok) chunk.bad = true;
+                out.positions[chunk.firstPosition + positions] = glm::vec3(xyz[0], xyz[1], xyz[2]);
+            }
+            positions++;
+        }
+        else if (keyword == 2) {
+            if (write) {
+                float uv[2];
+                bool ok = true;
+                parseFloats(p + 2, lineEnd, uv, 2, ok);
+                if (!ok) chunk.bad = true;
+                out.uvs[chunk.firstUV + uvs] = glm::vec2(uv[0], uv[1]);
+            }
+            uvs++;
+        }
+        else if (p[0] == 'f') {
+            // Corners "v", "v/vt", "v//vn" or "v/vt/vn", fanned from the first
+            unsigned int first[2] = {}, previous[2] = {};
+            int corner = 0;
+            for (p = skipBlanks(p + 1, lineEnd); p < lineEnd; p = skipBlanks(p, lineEnd), corner++) {
+                if (!write) {
+                    while (p < lineEnd && !isBlank(*p)) p++;
+                }
+                else {
+                    long long v = 0, vt = 0;
+                    std::from_chars_result r = std::from_chars(p, lineEnd, v);
+                    if (r.ec != std::errc()) {
+                        chunk.bad = true;
+                        break;
+                    }
+                    p = r.ptr;
+                    if (p < lineEnd && *p == '/' && p + 1 < lineEnd && p[1] != '/') {
+                        r = std::from_chars(p + 1, lineEnd, vt);
+                        if (r.ec != std::errc()) chunk.bad = true;
+                        p = r.ptr;
+                    }
+                    while (p < lineEnd && !isBlank(*p)) p++;
+
+                    unsigned int current[2] = {
+                        resolveIndex(v, chunk.firstPosition + positions, out.positionCount),
+                        vt ? resolveIndex(vt, chunk.firstUV + uvs, out.uvCount) : NO_UV
+                    };
+                    if (current[0] == ~0u || (vt && current[1] == ~0u)) chunk.bad = true;
+                    if (corner == 0) std::copy(current, current + 2, first);
+                    if (corner >= 2) {
+                        size_t t = 3 * (chunk.firstTriangle + triangles + corner - 2);
+                        out.corners[t] = first[0];
+                        out.corners[t + 1] = previous[0];
+                        out.corners[t + 2] = current[0];
+                        out.cornerUVs[t] = first[1];
+                        out.cornerUVs[t + 1] = previous[1];
+                        out.cornerUVs[t + 2] = current[1];
+                    }
+                    std::copy(current, current + 2, previous);
+                }
+            }
+            if (corner >= 3) triangles += corner - 2;
+        }
+    }
+
+    chunk.positions = positions;
+    chunk.uvs = uvs;
+    chunk.triangles = triangles;
+}
+
+inline uint64_t positionHash(const glm::vec3& p) {
+    // + 0.0f folds -0 into 0, so they weld
+    uint32_t bits[3];
+    const float xyz[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+    std::memcpy(bits, xyz, sizeof(bits));
+    uint64_t h = (uint64_t(bits[0]) << 32 | bits[1]) * 0x9E3779B97F4A7C15ull;
+    h ^= (h >> 29) ^ (uint64_t(bits[2]) * 0xBF58476D1CE4E5B9ull);
+    return h ^ (h >> 32);
+}
+
+} // namespace
+
+bool loadObj(const std::string& path, ObjMesh& mesh, TaskPool* pool) {
+    MappedFile file(path);
+    if (!file.data()) {
+        std::cout << "Failed to open OBJ file: " << path << std::endl;
+        return false;
+    }
+
+    auto forEach = [pool](int count, auto&& body) {
+        if (pool) {
+            pool->parallelFor(count, 1, [&](int begin, int end) {
+                for (int i = begin; i < end; i++) body(i);
+            });
+        }
+        else {
+            for (int i = 0; i < count; i++) body(i);
+        }
+    };
+
+    // Chunks end just after a line break (or at the end of the file)
+    const char* const data = file.data();
+    const size_t size = file.size();
+    size_t wanted = pool ? static_cast<size_t>(pool->threadCount()) * CHUNKS_PER_THREAD : 1;
+    wanted = std::max<size_t>(1, std::min(wanted, size / MIN_CHUNK_BYTES));
+    std::vector<Chunk> chunks;
+    for (const char* begin = data; begin < data + size;) {
+        const char* end = std::min(data + size, begin + std::max<size_t>(1, size / wanted));
+        const char* lineEnd = static_cast<const char*>(std::memchr(end, '\n', data + size - end));
+        end = lineEnd ? lineEnd + 1 : data + size;
+        chunks.push_back({ begin, end });
+        begin = end;
+    }
+
+    // Pass 1: count, then give every chunk its slice of the outputs
+    const int chunkCount = static_cast<int>(chunks.size());
+    forEach(chunkCount, [&](int i) { parseChunk(chunks[i], Output()); });
+    Output out;
+    size_t triangleCount = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.firstPosition = out.positionCount;
+        chunk.firstUV = out.uvCount;
+        chunk.firstTriangle = triangleCount;
+        out.positionCount += chunk.positions;
+        out.uvCount += chunk.uvs;
+        triangleCount += chunk.triangles;
+    }
+    if (triangleCount == 0) {
+        std::cout << "No faces in OBJ file: " << path << std::endl;
+        return false;
+    }
+
+    // Pass 2: parse into place
+    std::vector<glm::vec3> positions(out.positionCount);
+    std::vector<glm::vec2> uvs(out.uvCount);
+    std::vector<unsigned int> corners(triangleCount * 3), cornerUVs(triangleCount * 3);
+    out.positions = positions.data();
+    out.uvs = uvs.data();
+    out.corners = corners.data();
+    out.cornerUVs = cornerUVs.data();
+    forEach(chunkCount, [&](int i) { parseChunk(chunks[i], out); });
+    for (const Chunk& chunk : chunks) {
+        if (chunk.bad) {
+            std::cout << "Invalid record in OBJ file: " << path << std::endl;
+            return false;
+        }
+    }
+
+    // Weld: sort by position hash; within a run of equal hashes each vertex
+    // maps to the first earlier one at the same position. Survivors keep
+    // their file order.
+    struct Key {
+        uint64_t hash;
+        unsigned int index;
+        bool operator<(const Key& o) const { return hash != o.hash ? hash < o.hash : index < o.index; }
+    };
+    std::vector<Key> keys(positions.size());
+    forEach(chunkCount, [&](int c) {
+        size_t begin = positions.size() * c / chunkCount, end = positions.size() * (c + 1) / chunkCount;
+        for (size_t i = begin; i < end; i++) keys[i] = { positionHash(positions[i]), static_cast<unsigned int>(i) };
+    });
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<unsigned int> weld(positions.size());
+    for (size_t run = 0; run < keys.size();) {
+        size_t runEnd = run + 1;
+        while (runEnd < keys.size() && keys[runEnd].hash == keys[run].hash) runEnd++;
+        for (size_t k = run; k < runEnd; k++) {
+            unsigned int self = keys[k].index;
+            weld[self] = self;
+            for (size_t j = run; j < k; j++) {
+                if (positions[keys[j].index] == positions[self]) {
+                    weld[self] = weld[keys[j].index];
+                    break;
+                }
+            }
+        }
+        run = runEnd;
+    }
+    unsigned int vertexCount = 0;
+    for (size_t i = 0; i < weld.size(); i++) weld[i] = weld[i] == i ? vertexCount++ : weld[weld[i]];
+
+    mesh.positions.resize(vertexCount);
+    mesh.uvs.assign(vertexCount, glm::vec2(0.0f));
+    for (size_t i = 0; i < positions.size(); i++) mesh.positions[weld[i]] = positions[i];
+
+    // Triangles on the welded vertices; a corner sets its vertex's uv if no
+    // earlier one did. Triangles that welding collapsed are dropped.
+    std::vector<char> hasUV(vertexCount, 0);
+    mesh.indices.clear();
+    mesh.indices.reserve(corners.size());
+    for (size_t t = 0; t < corners.size(); t += 3) {
+        unsigned int a = weld[corners[t]], b = weld[corners[t + 1]], c = weld[corners[t + 2]];
+        if (a == b || b == c || a == c) continue;
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = weld[corners[t + k]];
+            if (hasUV[v] || cornerUVs[t + k] == NO_UV) continue;
+            mesh.uvs[v] = uvs[cornerUVs[t + k]];
+            hasUV[v] = 1;
+        }
+        mesh.indices.push_back(a);
+        mesh.indices.push_back(b);
+        mesh.indices.push_back(c);
+    }
+    if (mesh.indices.empty()) {
+        std::cout << "No faces in OBJ file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class TaskPool;
+
+// ==========================================
+// OBJ Mesh Import
+// ==========================================
+// Reads the triangles of a Wavefront OBJ file (v, vt and f records; polygons
+// are fanned, negative indices count back from the last vertex; everything
+// else is skipped) for garment patterns of millions of triangles. The file
+// is memory-mapped and cut into chunks at line breaks. Every chunk is parsed
+// twice on the pool: once to count its records, once to write them straight
+// into the output arrays at the offsets the counts give, so no line is ever
+// copied or allocated. Vertices at exactly the same position are welded,
+// which joins the seams exporters split for their uv islands.
+struct ObjMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;        // per position, from its first face corner; 0 without vt
+    std::vector<unsigned int> indices; // triangles; welded to nothing are dropped
+};
+
+// Returns false, after printing why, when the file can't be read, holds a
+// face with an index out of range, or has no faces.
+bool loadObj(const std::string& path, ObjMesh& mesh, TaskPool* pool = nullptr);
@@ -0,0 +1,264 @@
+#include "ShaderManager.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t BINARY_MAGIC = 0x424B4C53; // "SLKB"
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool readFile(const fs::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+const char* stageName(GLenum type) {
+    switch (type) {
+    case GL_VERTEX_SHADER:          return "vertex";
+    case GL_FRAGMENT_SHADER:        return "fragment";
+    case GL_GEOMETRY_SHADER:        return "geometry";
+    case GL_TESS_CONTROL_SHADER:    return "tess control";
+    case GL_TESS_EVALUATION_SHADER: return "tess evaluation";
+    case GL_COMPUTE_SHADER:         return "compute";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+ShaderManager::ShaderManager(const fs::path& dir) : shaderDir(dir), cacheDir(dir / "cache") {
+    const char* vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    driverString = std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+
+    // Some drivers advertise the extension but expose zero binary formats.
+    if (GLEW_ARB_get_program_binary) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        binaryCacheSupported = formats > 0;
+    }
+    if (binaryCacheSupported) {
+        std::error_code ec;
+        fs::create_directories(cacheDir, ec);
+        if (ec) binaryCacheSupported = false;
+    }
+}
+
+ShaderManager::~ShaderManager() {
+    clear();
+}
+
+void ShaderManager::clear() {
+    for (auto& prog : programs) {
+        if (prog.id) glDeleteProgram(prog.id);
+    }
+    programs.clear();
+}
+
+fs::path ShaderManager::findShaderDirectory() {
+    for (const char* candidate : { "shaders", "../shaders", "../../shaders" }) {
+        std::error_code ec;
+        if (fs::is_directory(candidate, ec)) return fs::path(candidate);
+    }
+    return fs::path("shaders");
+}
+
+int ShaderManager::addProgram(const std::string& name, const std::vector<Stage>& stages, const std::vector<const char*>& uniformNames) {
+    Program prog;
+    prog.name = name;
+    prog.stages = stages;
+    for (const Stage& stage : stages) prog.paths.push_back(shaderDir / stage.file);
+    prog.uniformNames = uniformNames;
+    if (!build(prog)) return -1;
+
+    programs.push_back(std::move(prog));
+    return static_cast<int>(programs.size() - 1);
+}
+
+bool ShaderManager::build(Program& prog) {
+    std::vector<std::string> sources(prog.stages.size());
+    std::vector<fs::file_time_type> timestamps(prog.stages.size());
+    for (size_t i = 0; i < prog.stages.size(); i++) {
+        const fs::path& file = prog.paths[i];
+        std::error_code ec;
+        timestamps[i] = fs::last_write_time(file, ec);
+        if (ec || !readFile(file, sources[i])) {
+            std::cout << "Failed to read shader " << file.string() << std::endl;
+            return false;
+        }
+    }
+
+    fs::path cacheFile;
+    GLuint id = 0;
+    if (binaryCacheSupported) {
+        cacheFile = cachePath(prog, sources);
+        id = loadBinary(cacheFile);
+    }
+    if (!id) {
+        id = compileAndLink(prog, sources);
+        if (!id) return false;
+        if (binaryCacheSupported) saveBinary(id, cacheFile);
+    }
+
+    if (prog.id) glDeleteProgram(prog.id);
+    prog.id = id;
+    prog.timestamps = std::move(timestamps);
+    resolveUniforms(prog);
+    return true;
+}
+
+GLuint ShaderManager::compileAndLink(const Program& prog, const std::vector<std::string>& sources) {
+    GLuint id = glCreateProgram();
+    std::vector<GLuint> shaders;
+    bool ok = true;
+
+    for (size_t i = 0; i < prog.stages.size() && ok; i++) {
+        GLuint shader = glCreateShader(prog.stages[i].type);
+        const char* src = sources[i].c_str();
+        glShaderSource(shader, 1, &src, NULL);
+        glCompileShader(shader);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status) {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+            std::cout << "Shader compile error (" << prog.name << ", " << stageName(prog.stages[i].type) << "):\n" << log << std::endl;
+            ok = false;
+        }
+        glAttachShader(id, shader);
+        shaders.push_back(shader);
+    }
+
+    if (ok) {
+        if (binaryCacheSupported) glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(id);
+
+        GLint status = GL_FALSE;
+        glGetProgramiv(id, GL_LINK_STATUS, &status);
+        if (!status) {
+            char log[1024];
+            glGetProgramInfoLog(id, sizeof(log), NULL, log);
+            std::cout << "Shader link error (" << prog.name << "):\n" << log << std::endl;
+            ok = false;
+        }
+    }
+
+    for (GLuint shader : shaders) {
+        glDetachShader(id, shader);
+        glDeleteShader(shader);
+    }
+    if (!ok) {
+        glDeleteProgram(id);
+        return 0;
+    }
+    return id;
+}
+
+fs::path ShaderManager::cachePath(const Program& prog, const std::vector<std::string>& sources) const {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = fnv1a(hash, driverString.data(), driverString.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        hash = fnv1a(hash, &prog.stages[i].type, sizeof(GLenum));
+        hash = fnv1a(hash, sources[i].data(), sources[i].size());
+    }
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return cacheDir / (prog.name + "-" + hex + ".bin");
+}
+
+GLuint ShaderManager::loadBinary(const fs::path& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return 0;
+
+    uint32_t header[3] = {};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || header[0] != BINARY_MAGIC || header[2] == 0) return 0;
+
+    std::vector<char> blob(header[2]);
+    in.read(blob.data(), static_cast<std::streamsize>(blob.size()));
+    if (!in) return 0;
+
+    GLuint id = glCreateProgram();
+    glProgramBinary(id, static_cast<GLenum>(header[1]), blob.data(), static_cast<GLsizei>(blob.size()));
+
+    // The driver may reject a binary after an update even if the version string matches.
+    GLint status = GL_FALSE;
+    glGetProgramiv(id, GL_LINK_STATUS, &status);
+    if (!status) {
+        glDeleteProgram(id);
+        return 0;
+    }
+    return id;
+}
+
+void ShaderManager::saveBinary(GLuint id, const fs::path& file) {
+    GLint length = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> blob(length);
+    GLenum format = 0;
+    glGetProgramBinary(id, length, NULL, &format, blob.data());
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) return;
+    uint32_t header[3] = { BINARY_MAGIC, static_cast<uint32_t>(format), static_cast<uint32_t>(length) };
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(blob.data(), length);
+}
+
+void ShaderManager::resolveUniforms(Program& prog) {
+    prog.locations.resize(prog.uniformNames.size());
+    for (size_t i = 0; i < prog.uniformNames.size(); i++) {
+        prog.locations[i] = glGetUniformLocation(prog.id, prog.uniformNames[i]);
+    }
+}
+
+bool ShaderManager::pollChanges(double now) {
+    if (now - lastPoll < pollInterval) return false;
+    lastPoll = now;
+
+    bool reloaded = false;
+    for (auto& prog : programs) {
+        bool changed = false;
+        for (size_t i = 0; i < prog.stages.size(); i++) {
+            std::error_code ec;
+            auto stamp = fs::last_write_time(prog.paths[i], ec);
+            if (!ec && stamp != prog.timestamps[i]) changed = true;
+        }
+        if (!changed) continue;
+
+        if (build(prog)) {
+            std::cout << "Reloaded shader program: " << prog.name << std::endl;
+            reloaded = true;
+        }
+        else {
+            // Don't retry the broken source every poll; wait for the next edit.
+            for (size_t i = 0; i < prog.stages.size(); i++) {
+                std::error_code ec;
+                prog.timestamps[i] = fs::last_write_time(prog.paths[i], ec);
+            }
+        }
+    }
+    return reloaded;
+}
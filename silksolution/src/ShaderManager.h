@@ -0,0 +1,75 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// ==========================================
+// Shader Program Manager
+// ==========================================
+// Loads GLSL programs from the shaders/ directory, caches linked programs with
+// glProgramBinary (keyed by source hash + driver string) and re-links programs
+// whose source files change on disk. Uniform locations are resolved once per
+// link into a table indexed by the caller's own enum.
+class ShaderManager {
+public:
+    struct Stage {
+        GLenum type;
+        std::string file; // relative to the shader directory
+    };
+
+    explicit ShaderManager(const std::filesystem::path& shaderDir);
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    // Returns a handle, or -1 if the program could not be built.
+    int addProgram(const std::string& name, const std::vector<Stage>& stages, const std::vector<const char*>& uniformNames);
+
+    GLuint program(int handle) const { return programs[handle].id; }
+    GLint uniform(int handle, int slot) const { return programs[handle].locations[slot]; }
+
+    // Checks source timestamps at most every pollInterval seconds and re-links
+    // changed programs. A failed rebuild keeps the previous program alive.
+    // Returns true if any program was replaced.
+    bool pollChanges(double now);
+
+    // Deletes all programs; call before the context goes away.
+    void clear();
+
+    bool binaryCacheEnabled() const { return binaryCacheSupported; }
+
+    // Looks for a "shaders" directory next to the working directory or above it.
+    static std::filesystem::path findShaderDirectory();
+
+    double pollInterval = 0.5;
+
+private:
+    struct Program {
+        std::string name;
+        std::vector<Stage> stages;
+        std::vector<std::filesystem::path> paths; // shaderDir / stage file, built once for polling
+        std::vector<const char*> uniformNames;
+        std::vector<GLint> locations;
+        std::vector<std::filesystem::file_time_type> timestamps;
+        GLuint id = 0;
+    };
+
+    bool build(Program& prog);
+    GLuint compileAndLink(const Program& prog, const std::vector<std::string>& sources);
+    GLuint loadBinary(const std::filesystem::path& file);
+    void saveBinary(GLuint id, const std::filesystem::path& file);
+    std::filesystem::path cachePath(const Program& prog, const std::vector<std::string>& sources) const;
+    void resolveUniforms(Program& prog);
+
+    std::filesystem::path shaderDir;
+    std::filesystem::path cacheDir;
+    std::string driverString;
+    bool binaryCacheSupported = false;
+    double lastPoll = 0.0;
+    std::vector<Program> programs;
+};
@@ -0,0 +1,122 @@
+#include "TaskPool.h"
+
+namespace {
+
+thread_local int workerIndex = -1;
+
+} // namespace
+
+TaskPool::TaskPool(int threadCountRequested) : queues(threadCountRequested > 0 ? threadCountRequested : std::max(1u, std::thread::hardware_concurrency())) {
+    for (auto& q : queues) q.ring.resize(QUEUE_CAPACITY);
+
+    ownerThread = std::this_thread::get_id();
+    workerIndex = 0;
+    for (int i = 1; i < threadCount(); i++) {
+        threads.emplace_back(&TaskPool::workerLoop, this, i);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lk(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+int TaskPool::currentWorker() const {
+    // Threads outside the pool share the owner's deque
+    if (workerIndex >= 0 && workerIndex < threadCount()) return workerIndex;
+    return 0;
+}
+
+void TaskPool::spawn(Group& group, TaskFn fn, void* context, int index) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    Task task{ fn, context, index, &group };
+
+    Queue& q = queues[currentWorker()];
+    {
+        std::lock_guard<std::mutex> lk(q.lock);
+        if (q.count < q.ring.size()) {
+            q.ring[(q.head + q.count) % q.ring.size()] = task;
+            q.count++;
+            task.fn = nullptr;
+        }
+    }
+    if (task.fn) {
+        run(task);
+        return;
+    }
+
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lk(sleepLock);
+    }
+    wake.notify_one();
+}
+
+bool TaskPool::popBack(int qi, Task& task) {
+    Queue& q = queues[qi];
+    std::lock_guard<std::mutex> lk(q.lock);
+    if (q.count == 0) return false;
+    q.count--;
+    task = q.ring[(q.head + q.count) % q.ring.size()];
+    return true;
+}
+
+bool TaskPool::popFront(int qi, Task& task) {
+    Queue& q = queues[qi];
+    std::lock_guard<std::mutex> lk(q.lock);
+    if (q.count == 0) return false;
+    task = q.ring[q.head];
+    q.head = (q.head + 1) % q.ring.size();
+    q.count--;
+    return true;
+}
+
+bool TaskPool::findTask(int self, Task& task) {
+    if (queued.load(std::memory_order_acquire) == 0) return false;
+    if (popBack(self, task)) return true;
+
+    const int n = threadCount();
+    for (int i = 1; i < n; i++) {
+        if (popFront((self + i) % n, task)) return true;
+    }
+    return false;
+}
+
+void TaskPool::run(const Task& task) {
+    task.fn(task.context, task.index);
+    task.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void TaskPool::wait(Group& group) {
+    const int self = currentWorker();
+    Task task;
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (findTask(self, task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            run(task);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskPool::workerLoop(int self) {
+    workerIndex = self;
+    Task task;
+    while (true) {
+        if (findTask(self, task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleepLock);
+        wake.wait(lk, [&] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ==========================================
+// Work-Stealing Task Pool
+// ==========================================
+// Every thread owns a deque. A thread pushes and pops its own tasks at the
+// back (last in, first out, so sub-tasks run while their data is warm); an
+// idle thread steals from the front of another deque. Tasks are a function
+// pointer plus context, so spawning does not allocate. wait() keeps the
+// waiting thread busy with queued tasks until its group is done, which lets
+// a task split itself into sub-tasks and wait for them.
+// The thread that constructs the pool counts as worker 0.
+class TaskPool {
+public:
+    typedef void (*TaskFn)(void* context, int index);
+
+    struct Group {
+        std::atomic<int> pending{ 0 };
+    };
+
+    // threads: total worker count including the caller, 0 = all cores
+    explicit TaskPool(int threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    int threadCount() const { return static_cast<int>(queues.size()); }
+
+    void spawn(Group& group, TaskFn fn, void* context, int index);
+    void wait(Group& group);
+
+    // Calls body(begin, end) over [0, count) in chunks of at most grain
+    // items; chunk i starts at i * grain.
+    template <class Body>
+    void parallelFor(int count, int grain, const Body& body);
+
+private:
+    struct Task {
+        TaskFn fn;
+        void* context;
+        int index;
+        Group* group;
+    };
+
+    // Fixed-capacity ring; a full deque makes spawn() run the task inline.
+    struct alignas(64) Queue {
+        std::mutex lock;
+        std::vector<Task> ring;
+        size_t head = 0, count = 0;
+    };
+
+    static const size_t QUEUE_CAPACITY = 4096;
+
+    int currentWorker() const;
+    bool popBack(int q, Task& task);
+    bool popFront(int q, Task& task);
+    bool findTask(int self, Task& task);
+    void run(const Task& task);
+    void workerLoop(int self);
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> threads;
+    std::thread::id ownerThread;
+    std::atomic<int> queued{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::mutex sleepLock;
+    std::condition_variable wake;
+};
+
+template <class Body>
+void TaskPool::parallelFor(int count, int grain, const Body& body) {
+    if (count <= 0) return;
+    grain = std::max(1, grain);
+    const int chunks = (count + grain - 1) / grain;
+    if (chunks == 1 || threadCount() == 1) {
+        for (int begin = 0; begin < count; begin += grain) body(begin, std::min(count, begin + grain));
+        return;
+    }
+
+    struct Range {
+        const Body* body;
+        int count, grain;
+    } range{ &body, count, grain };
+
+    Group group;
+    for (int c = 1; c < chunks; c++) {
+        spawn(group, [](void* context, int chunk) {
+            const Range& r = *static_cast<const Range*>(context);
+            int begin = chunk * r.grain;
+            (*r.body)(begin, std::min(r.count, begin + r.grain));
+        }, &range, c);
+    }
+    body(0, std::min(count, grain));
+    wait(group);
+}
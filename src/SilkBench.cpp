@@ -0,0 +1,277 @@
+// Microbenchmark for SilkSimulation::step and SilkEnsemble, no window or GL
+// context:
+//   silk_step        one SilkSimulation::step of a square grid, serial and
+//                    on strip threads (setThreading; grids under its
+//                    threshold stay serial)
+//   silk_scalarN     one step of N SilkSimulation grids, one after another
+//   silk_ensembleN   one SilkEnsemble<N>::step over the same N grids
+// for N = 8 and 16; the ensemble cases run on one thread. Each case warms
+// up, then times repetitions of enough calls to last a couple of
+// milliseconds from the same hanging state, and reports the median time per
+// call and its median absolute deviation (MAD).
+//
+// Before timing anything, every lane of an 8- and a 16-lane ensemble with
+// per-lane gravity, damping and pins is stepped next to a SilkSimulation
+// with the lane's settings; any lane that differs in a single bit fails the
+// run. (Compilers that contract a * b + c into FMA, e.g. gcc with
+// -march=native, break this; build with -ffp-contract=off there.)
+//
+//   SilkBench [results.json] [--sizes 32,64] [--thread-counts 1,4] [--reps N]
+//
+// The JSON has silksolution --kernel-bench's one-case-per-line layout, so
+// silksolution --bench-compare FILE --baseline FILE gates it the same way.
+// Built on its own with SilkSimulation.cpp and SilkEnsemble.cpp (stepping
+// needs no GL).
+#include "SilkEnsemble.h"
+#include "SilkSimulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+const float kStep = 1.0f / 60.0f;
+const int kHangSteps = 60;
+const int kWarmup = 3;
+const double kMinRepetitionMs = 2.0;
+const int kMaxCalls = 1 << 16;
+// the ensemble check: the default SilkSimulation size, two seconds
+const int kCheckWidth = 48;
+const int kCheckHeight = 32;
+const int kCheckSteps = 120;
+
+struct CaseResult {
+    std::string kernel;
+    int size = 0, threads = 1, calls = 0;
+    double medianNs = 0.0, madNs = 0.0;
+};
+
+double median(std::vector<double> values)
+{
+    const size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    if (values.size() % 2) return values[mid];
+    return (values[mid] + *std::max_element(values.begin(), values.begin() + mid)) * 0.5;
+}
+
+bool parseList(const char *text, std::vector<int> &values)
+{
+    values.clear();
+    while (*text) {
+        char *end = nullptr;
+        long value = strtol(text, &end, 10);
+        if (end == text || value <= 0 || (*end && *end != ',')) return false;
+        values.push_back((int)value);
+        text = *end ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+// Times body(); reset() puts the state back before every repetition
+template <class Body, class Reset>
+CaseResult measure(int repetitions, const Body &body, const Reset &reset)
+{
+    auto timeCalls = [&](int calls) {
+        reset();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; ++i) body();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    CaseResult result;
+    timeCalls(kWarmup);
+    result.calls = 1;
+    while (result.calls < kMaxCalls && timeCalls(result.calls) < kMinRepetitionMs * 1e6) result.calls *= 2;
+
+    std::vector<double> perCall(repetitions);
+    for (double &t : perCall) t = timeCalls(result.calls) / result.calls;
+    result.medianNs = median(perCall);
+    for (double &t : perCall) t = std::fabs(t - result.medianNs);
+    result.madNs = median(perCall);
+    return result;
+}
+
+void report(const CaseResult &r)
+{
+    printf("%-15s %5d %7d %8d %12.2f %7.2f%%\n", r.kernel.c_str(), r.size, r.threads, r.calls, r.medianNs / 1000.0,
+        r.medianNs > 0.0 ? 100.0 * r.madNs / r.medianNs : 0.0);
+    fflush(stdout);
+}
+
+CaseResult benchStep(int size, int threads, int repetitions)
+{
+    SilkSimulation sim(size, size);
+    sim.setThreading(threads);
+    // each repetition starts from the same second of hanging
+    CaseResult result = measure(repetitions, [&]() { sim.step(kStep); }, [&]() {
+        sim.initialize();
+        for (int i = 0; i < kHangSteps; ++i) sim.step(kStep);
+    });
+    result.kernel = "silk_step";
+    result.size = size;
+    result.threads = threads;
+    return result;
+}
+
+// Monte-Carlo style settings for member `lane` of an ensemble: gravity
+// leaning either way, damping spread around the default, and every other
+// grid with a free top-left corner
+void configure(SilkSimulation &sim, int lane)
+{
+    sim.initialize();
+    sim.setGravity(0.05f * (lane % 5) - 0.1f, -1.5f + 0.04f * lane);
+    sim.setDamping(0.999f + 0.00005f * lane);
+    if (lane % 2) sim.setPinned(0, 0, false);
+}
+
+// Steps an ensemble and one SilkSimulation per lane side by side; returns
+// the number of lanes whose state differs anywhere
+template <int Lanes>
+int checkEnsemble()
+{
+    SilkEnsemble<Lanes> ensemble(kCheckWidth, kCheckHeight);
+    std::vector<std::unique_ptr<SilkSimulation>> sims;
+    for (int l = 0; l < Lanes; ++l) {
+        sims.push_back(std::make_unique<SilkSimulation>(kCheckWidth, kCheckHeight));
+        configure(*sims[l], l);
+        ensemble.loadLane(l, *sims[l]);
+    }
+    for (int i = 0; i < kCheckSteps; ++i) {
+        ensemble.step(kStep);
+        for (auto &sim : sims) sim->step(kStep);
+    }
+
+    int mismatched = 0;
+    SilkSimulation lane(kCheckWidth, kCheckHeight);
+    lane.initialize();
+    for (int l = 0; l < Lanes; ++l) {
+        ensemble.storeLane(l, lane);
+        int points = 0;
+        for (int y = 0; y < kCheckHeight; ++y) {
+            for (int x = 0; x < kCheckWidth; ++x) {
+                float a[4], b[4];
+                sims[l]->getPoint(x, y, a[0], a[1], a[2], a[3]);
+                lane.getPoint(x, y, b[0], b[1], b[2], b[3]);
+                if (memcmp(a, b, sizeof(a)) != 0) ++points;
+            }
+        }
+        if (points) {
+            printf("SilkEnsemble<%d> lane %d: %d of %d points differ from SilkSimulation\n", Lanes, l, points,
+                kCheckWidth * kCheckHeight);
+            ++mismatched;
+        }
+    }
+    return mismatched;
+}
+
+// N scalar grids stepped one after another, then SilkEnsemble<N> stepping
+// the same grids at once. Both start each repetition from the grids after a
+// second of hanging, kept in an ensemble.
+template <int Lanes>
+void benchEnsemble(int size, int repetitions, std::vector<CaseResult> &results)
+{
+    std::vector<std::unique_ptr<SilkSimulation>> sims;
+    SilkEnsemble<Lanes> hanging(size, size);
+    for (int l = 0; l < Lanes; ++l) {
+        sims.push_back(std::make_unique<SilkSimulation>(size, size));
+        configure(*sims[l], l);
+        for (int i = 0; i < kHangSteps; ++i) sims[l]->step(kStep);
+        hanging.loadLane(l, *sims[l]);
+    }
+
+    CaseResult scalar = measure(repetitions, [&]() {
+        for (auto &sim : sims) sim->step(kStep);
+    }, [&]() {
+        for (int l = 0; l < Lanes; ++l) hanging.storeLane(l, *sims[l]);
+    });
+    scalar.kernel = "silk_scalar" + std::to_string(Lanes);
+    scalar.size = size;
+    report(scalar);
+    results.push_back(scalar);
+
+    SilkEnsemble<Lanes> ensemble = hanging;
+    CaseResult simd = measure(repetitions, [&]() { ensemble.step(kStep); }, [&]() { ensemble = hanging; });
+    simd.kernel = "silk_ensemble" + std::to_string(Lanes);
+    simd.size = size;
+    report(simd);
+    results.push_back(simd);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string outputFile;
+    std::vector<int> sizes = { 32, 64, 128, 256 };
+    std::vector<int> threadCounts;
+    int repetitions = 15;
+    for (int i = 1; i < argc; ++i) {
+        const char *value = i + 1 < argc ? argv[i + 1] : "";
+        if (!strcmp(argv[i], "--sizes") || !strcmp(argv[i], "--thread-counts")) {
+            if (!parseList(value, !strcmp(argv[i], "--sizes") ? sizes : threadCounts)) {
+                printf("Invalid %s, expected a list like 32,64,128\n", argv[i]);
+                return -1;
+            }
+            ++i;
+        }
+        else if (!strcmp(argv[i], "--reps")) {
+            repetitions = std::max(1, atoi(value));
+            ++i;
+        }
+        else {
+            outputFile = argv[i];
+        }
+    }
+    if (threadCounts.empty()) {
+        threadCounts.push_back(1);
+        int cores = (int)std::thread::hardware_concurrency();
+        if (cores > 1) threadCounts.push_back(cores);
+    }
+
+    const int mismatched = checkEnsemble<8>() + checkEnsemble<16>();
+    if (mismatched) {
+        printf("%d ensemble lanes differ from SilkSimulation\n", mismatched);
+        return -1;
+    }
+    printf("SilkEnsemble<8> and <16> match SilkSimulation bit for bit over %d steps\n", kCheckSteps);
+
+    std::vector<CaseResult> results;
+    printf("%-15s %5s %7s %8s %12s %8s\n", "kernel", "size", "threads", "calls", "median us", "MAD");
+    for (int threads : threadCounts) {
+        for (int size : sizes) {
+            results.push_back(benchStep(std::max(size, 2), threads, repetitions));
+            report(results.back());
+        }
+    }
+    for (int size : sizes) {
+        benchEnsemble<8>(std::max(size, 2), repetitions, results);
+        benchEnsemble<16>(std::max(size, 2), repetitions, results);
+        const CaseResult *r = &results[results.size() - 4];
+        printf("%-15s %5d   ensemble speedup %.2fx (8 lanes), %.2fx (16 lanes)\n", "", r[0].size,
+            r[0].medianNs / r[1].medianNs, r[2].medianNs / r[3].medianNs);
+    }
+
+    if (outputFile.empty()) return 0;
+    FILE *file = fopen(outputFile.c_str(), "w");
+    if (!file) {
+        printf("Failed to write %s\n", outputFile.c_str());
+        return -1;
+    }
+    fprintf(file, "{\n  \"suite\": \"silk-simulation\",\n  \"warmup\": %d,\n  \"repetitions\": %d,\n", kWarmup, repetitions);
+    fprintf(file, "  \"min_repetition_ms\": %.3f,\n  \"hardware_threads\": %u,\n  \"results\": [\n",
+        kMinRepetitionMs, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CaseResult &r = results[i];
+        fprintf(file, "    { \"kernel\": \"%s\", \"size\": %d, \"threads\": %d, \"calls\": %d, \"median_ns\": %.1f, \"mad_ns\": %.1f }%s\n",
+            r.kernel.c_str(), r.size, r.threads, r.calls, r.medianNs, r.madNs, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    printf("Wrote %zu cases to %s\n", results.size(), outputFile.c_str());
+    return 0;
+}
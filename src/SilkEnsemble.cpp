@@ -0,0 +1,193 @@
+#include "SilkEnsemble.h"
+#include "SilkSimulation.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+namespace {
+// same constants as SilkSimulation::step
+const float kGravityY = -1.5f;
+const float kDamping = 0.9995f;
+const int kIterations = 6;
+
+// Lane vectors: AVX when the compiler targets it (/arch:AVX, -mavx), SSE2
+// otherwise. Only correctly rounded operations, so a lane matches the scalar
+// SilkSimulation bit for bit.
+#if defined(__AVX__)
+typedef __m256 Vec;
+const int kVecWidth = 8;
+inline Vec load(const float *p) { return _mm256_load_ps(p); }
+inline void store(float *p, Vec v) { _mm256_store_ps(p, v); }
+inline Vec splat(float f) { return _mm256_set1_ps(f); }
+inline Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+inline Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+inline Vec root(Vec a) { return _mm256_sqrt_ps(a); }
+inline Vec greater(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline Vec notEqual(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+inline Vec select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+#else
+typedef __m128 Vec;
+const int kVecWidth = 4;
+inline Vec load(const float *p) { return _mm_load_ps(p); }
+inline void store(float *p, Vec v) { _mm_store_ps(p, v); }
+inline Vec splat(float f) { return _mm_set1_ps(f); }
+inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+inline Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+inline Vec root(Vec a) { return _mm_sqrt_ps(a); }
+inline Vec greater(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+inline Vec notEqual(Vec a, Vec b) { return _mm_cmpneq_ps(a, b); }
+inline Vec select(Vec mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+#endif
+} // namespace
+
+template <int Lanes>
+SilkEnsemble<Lanes>::SilkEnsemble(int width, int height)
+    : m_width(width), m_height(height)
+{
+    for (int l = 0; l < Lanes; ++l) {
+        m_gravityX[l] = 0.0f;
+        m_gravityY[l] = kGravityY;
+        m_damping[l] = kDamping;
+    }
+}
+
+template <int Lanes>
+void SilkEnsemble<Lanes>::initialize()
+{
+    m_blocks.assign(m_width * m_height, Block());
+
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            float fx = (float)x / (m_width - 1) - 0.5f;
+            float fy = 0.5f - (float)y / (m_height - 1);
+            Block &b = m_blocks[y * m_width + x];
+            for (int l = 0; l < Lanes; ++l) {
+                b.x[l] = b.prevX[l] = fx;
+                b.y[l] = b.prevY[l] = fy;
+                b.free[l] = (y == 0) ? 0.0f : 1.0f;
+            }
+        }
+    }
+}
+
+template <int Lanes>
+void SilkEnsemble<Lanes>::setGravity(int lane, float gx, float gy)
+{
+    m_gravityX[lane] = gx;
+    m_gravityY[lane] = gy;
+}
+
+template <int Lanes>
+void SilkEnsemble<Lanes>::setDamping(int lane, float damping)
+{
+    m_damping[lane] = damping;
+}
+
+template <int Lanes>
+void SilkEnsemble<Lanes>::setPinned(int lane, int x, int y, bool pinned)
+{
+    m_blocks[y * m_width + x].free[lane] = pinned ? 0.0f : 1.0f;
+}
+
+template <int Lanes>
+bool SilkEnsemble<Lanes>::loadLane(int lane, const SilkSimulation &sim)
+{
+    if (sim.width() != m_width || sim.height() != m_height) return false;
+    if (m_blocks.empty()) initialize();
+
+    m_gravityX[lane] = sim.gravityX();
+    m_gravityY[lane] = sim.gravityY();
+    m_damping[lane] = sim.damping();
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            Block &b = m_blocks[y * m_width + x];
+            sim.getPoint(x, y, b.x[lane], b.y[lane], b.prevX[lane], b.prevY[lane]);
+            b.free[lane] = sim.pinned(x, y) ? 0.0f : 1.0f;
+        }
+    }
+    return true;
+}
+
+template <int Lanes>
+bool SilkEnsemble<Lanes>::storeLane(int lane, SilkSimulation &sim) const
+{
+    if (sim.width() != m_width || sim.height() != m_height || m_blocks.empty()) return false;
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            const Block &b = m_blocks[y * m_width + x];
+            sim.setPoint(x, y, b.x[lane], b.y[lane], b.prevX[lane], b.prevY[lane]);
+        }
+    }
+    return true;
+}
+
+template <int Lanes>
+inline void SilkEnsemble<Lanes>::solveLink(Block &a, Block &b, float rest)
+{
+    const Vec target = splat(rest), half = splat(0.5f), eps = splat(1e-6f), zero = splat(0.0f);
+    for (int l = 0; l < Lanes; l += kVecWidth) {
+        Vec ax = load(a.x + l), ay = load(a.y + l);
+        Vec bx = load(b.x + l), by = load(b.y + l);
+        Vec dx = sub(bx, ax);
+        Vec dy = sub(by, ay);
+        Vec dist = root(add(mul(dx, dx), mul(dy, dy)));
+        // SilkSimulation's early-out on coincident points, as a select
+        Vec diff = select(greater(dist, eps), mul(div(sub(dist, target), dist), half), zero);
+        Vec da = mul(diff, load(a.free + l));
+        Vec db = mul(diff, load(b.free + l));
+        store(a.x + l, add(ax, mul(dx, da))); store(a.y + l, add(ay, mul(dy, da)));
+        store(b.x + l, sub(bx, mul(dx, db))); store(b.y + l, sub(by, mul(dy, db)));
+    }
+}
+
+template <int Lanes>
+void SilkEnsemble<Lanes>::step(float dt)
+{
+    if (dt <= 0.0f) return;
+    const float dt2 = dt * dt;
+
+    // Verlet integrate; pinned lanes keep pos and prev
+    const Vec zero = splat(0.0f), step2 = splat(dt2);
+    for (Block &b : m_blocks) {
+        for (int l = 0; l < Lanes; l += kVecWidth) {
+            Vec moves = notEqual(load(b.free + l), zero);
+            Vec damping = load(m_damping + l);
+            Vec x = load(b.x + l), y = load(b.y + l);
+            Vec px = load(b.prevX + l), py = load(b.prevY + l);
+            Vec nx = add(x, add(mul(sub(x, px), damping), mul(load(m_gravityX + l), step2)));
+            Vec ny = add(y, add(mul(sub(y, py), damping), mul(load(m_gravityY + l), step2)));
+            store(b.x + l, select(moves, nx, x));
+            store(b.y + l, select(moves, ny, y));
+            store(b.prevX + l, select(moves, x, px));
+            store(b.prevY + l, select(moves, y, py));
+        }
+    }
+
+    // constraints: structural (neighbors), same order as SilkSimulation
+    const float restX = 1.0f / (m_width - 1);
+    const float restY = 1.0f / (m_height - 1);
+    for (int it = 0; it < kIterations; ++it) {
+        for (int y = 0; y < m_height; ++y) {
+            Block *row = &m_blocks[y * m_width];
+            for (int x = 0; x < m_width - 1; ++x)
+                solveLink(row[x], row[x + 1], restX);
+        }
+        for (int y = 0; y < m_height - 1; ++y) {
+            Block *row = &m_blocks[y * m_width];
+            Block *below = row + m_width;
+            for (int x = 0; x < m_width; ++x)
+                solveLink(row[x], below[x], restY);
+        }
+    }
+}
+
+static_assert(8 % kVecWidth == 0, "lane count must fill whole vectors");
+
+template class SilkEnsemble<8>;
+template class SilkEnsemble<16>;
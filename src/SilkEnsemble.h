@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+
+class SilkSimulation;
+
+// Steps Lanes same-sized silk grids at once, one SIMD lane per instance.
+// Storage is AoSoA: one block per grid point holding that point's state for
+// every lane, so each scalar operation of SilkSimulation::step becomes one
+// Lanes-wide operation over contiguous floats. Gravity, damping and pins are
+// per lane and applied with selects, so no lane ever branches.
+// Instantiated for 8 and 16 lanes (one or two AVX registers, two or four SSE).
+//
+// A lane steps exactly like a SilkSimulation with the same settings whose
+// step() gets the same dt every time (the ensemble keeps no previous step
+// length to rescale velocities by). SilkBench checks this bit for bit.
+// Typical Monte-Carlo use: set up Lanes SilkSimulation grids with their own
+// gravity, damping and pins, loadLane() them, step the ensemble and storeLane() the
+// lanes back to read the results.
+template <int Lanes>
+class SilkEnsemble {
+public:
+    SilkEnsemble(int width = 48, int height = 32);
+
+    // every lane: SilkSimulation's layout, gravity, damping and top-row pins
+    void initialize();
+    void step(float dt);
+
+    void setGravity(int lane, float gx, float gy);
+    void setDamping(int lane, float damping);
+    void setPinned(int lane, int x, int y, bool pinned);
+
+    // lane takes an initialized sim's grid state, gravity, damping and pins;
+    // false unless sim has this ensemble's size. Initializes the ensemble
+    // first if needed.
+    bool loadLane(int lane, const SilkSimulation &sim);
+    // writes the lane's grid state into an initialized sim; false unless
+    // the sizes match
+    bool storeLane(int lane, SilkSimulation &sim) const;
+
+    float positionX(int lane, int x, int y) const { return m_blocks[y * m_width + x].x[lane]; }
+    float positionY(int lane, int x, int y) const { return m_blocks[y * m_width + x].y[lane]; }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+private:
+    struct alignas(64) Block {
+        float x[Lanes];
+        float y[Lanes];
+        float prevX[Lanes];
+        float prevY[Lanes];
+        float free[Lanes]; // 1 simulated, 0 pinned
+    };
+
+    void solveLink(Block &a, Block &b, float rest);
+
+    int m_width;
+    int m_height;
+    std::vector<Block> m_blocks;
+    alignas(64) float m_gravityX[Lanes];
+    alignas(64) float m_gravityY[Lanes];
+    alignas(64) float m_damping[Lanes];
+};
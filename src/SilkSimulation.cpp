@@ -1,17 +1,208 @@
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
 #include "SilkSimulation.h"
 #include <GL/glut.h>
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
 #include <vector>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+static inline int idx(int x, int y, int w) { return y * w + x; }
+
+namespace {
+// same constants as step() always used; gravity and damping are only the
+// defaults, see setGravity() and setDamping()
+const float kGravityY = -1.5f;
+const float kDamping = 0.9995f;
+const int kIterations = 6;
+// below this the barriers cost more than the strips save
+const int kParallelMinParticles = 8192;
+// advance(): substep bounds, per-frame budget and the limits that pick the
+// substep. Link stretch grows with about the square of the step; a hanging
+// sheet sags to ~0.15 at 1/60 s, so the strain limit sits above that and
+// only cuts the step when something pulls harder. The travel limit keeps a
+// particle within half a link per substep.
+const float kMinStep = 0.002f;
+const float kMaxStep = 1.0f / 60.0f;
+const float kMaxFrameTime = 0.05f;
+const int kMaxSubsteps = 8;
+const float kTargetStrain = 0.25f;
+const float kMaxTravel = 0.5f; // in horizontal link lengths
+const float kGrowth = 1.25f;
+const float kSafety = 0.9f;
+} // namespace
 
 SilkSimulation::SilkSimulation(int width, int height)
-    : m_width(width), m_height(height)
+    : m_width(width), m_height(height), m_gravityY(kGravityY), m_damping(kDamping)
 {
 }
 
+// Persistent strip threads. The caller of step() works as worker 0; the
+// others sleep between steps and meet at a spinning barrier between phases.
+struct SilkSimulation::StripWorkers {
+    StripWorkers(SilkSimulation &sim, int count);
+    ~StripWorkers();
+
+    void run(float dt);
+    void barrier();
+    void loop(int worker);
+
+    SilkSimulation &sim;
+    const int count;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    unsigned stepGeneration = 0;
+    bool quit = false;
+    float dt = 0.0f;
+
+    std::atomic<int> arrived{ 0 };
+    std::atomic<unsigned> phase{ 0 };
+};
+
+SilkSimulation::StripWorkers::StripWorkers(SilkSimulation &owner, int workerCount)
+    : sim(owner), count(workerCount)
+{
+    for (int i = 1; i < count; ++i)
+        threads.emplace_back(&StripWorkers::loop, this, i);
+}
+
+SilkSimulation::StripWorkers::~StripWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads) t.join();
+}
+
+void SilkSimulation::StripWorkers::run(float stepDt)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dt = stepDt;
+        ++stepGeneration;
+    }
+    wake.notify_all();
+    // stepStrips ends on a barrier, so every strip is done when this returns
+    sim.stepStrips(0, stepDt);
+}
+
+void SilkSimulation::StripWorkers::barrier()
+{
+    const unsigned current = phase.load(std::memory_order_acquire);
+    if (arrived.fetch_add(1, std::memory_order_acq_rel) == count - 1) {
+        arrived.store(0, std::memory_order_relaxed);
+        phase.store(current + 1, std::memory_order_release);
+        return;
+    }
+    for (int spins = 0; phase.load(std::memory_order_acquire) == current; ++spins) {
+        if (spins > 256) std::this_thread::yield();
+    }
+}
+
+void SilkSimulation::StripWorkers::loop(int worker)
+{
+    unsigned seen = 0;
+    for (;;) {
+        float stepDt;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || stepGeneration != seen; });
+            if (quit) return;
+            seen = stepGeneration;
+            stepDt = dt;
+        }
+        sim.stepStrips(worker, stepDt);
+    }
+}
+
 SilkSimulation::~SilkSimulation() = default;
 
-static inline int idx(int x, int y, int w) { return y * w + x; }
+void SilkSimulation::setThreading(int threads, int stripHeight)
+{
+    m_workers.reset();
+    if (threads <= 1 || m_width * m_height < kParallelMinParticles) return;
+    // one strip per thread unless asked for thinner strips to balance load
+    m_stripHeight = stripHeight > 0 ? stripHeight : (m_height + threads - 1) / threads;
+    m_workers.reset(new StripWorkers(*this, threads));
+}
+
+// buffer object entry points (GL 1.5 / 3.1); the Windows GL header stops at 1.1
+namespace {
+const GLenum kArrayBuffer = 0x8892;
+const GLenum kElementArrayBuffer = 0x8893;
+const GLenum kStreamDraw = 0x88E0;
+const GLenum kStaticDraw = 0x88E4;
+const GLenum kWriteOnly = 0x88B9;
+const GLenum kPrimitiveRestart = 0x8F9D;
+const GLuint kRestartIndex = 0xFFFFFFFFu;
+
+typedef void (APIENTRY *GenBuffersFn)(GLsizei, GLuint *);
+typedef void (APIENTRY *DeleteBuffersFn)(GLsizei, const GLuint *);
+typedef void (APIENTRY *BindBufferFn)(GLenum, GLuint);
+typedef void (APIENTRY *BufferDataFn)(GLenum, std::ptrdiff_t, const void *, GLenum);
+typedef void *(APIENTRY *MapBufferFn)(GLenum, GLenum);
+typedef GLboolean (APIENTRY *UnmapBufferFn)(GLenum);
+typedef void (APIENTRY *PrimitiveRestartIndexFn)(GLuint);
+
+struct BufferApi {
+    GenBuffersFn GenBuffers = nullptr;
+    DeleteBuffersFn DeleteBuffers = nullptr;
+    BindBufferFn BindBuffer = nullptr;
+    BufferDataFn BufferData = nullptr;
+    MapBufferFn MapBuffer = nullptr;
+    UnmapBufferFn UnmapBuffer = nullptr;
+    PrimitiveRestartIndexFn PrimitiveRestartIndex = nullptr;
+};
+BufferApi gl;
+
+void *getProc(const char *name)
+{
+#ifdef _WIN32
+    PROC p = wglGetProcAddress(name);
+    // some drivers return small sentinel values instead of null
+    if (p == nullptr || p == (PROC)1 || p == (PROC)2 || p == (PROC)3 || p == (PROC)-1) return nullptr;
+    return (void *)p;
+#else
+    return (void *)glXGetProcAddressARB((const GLubyte *)name);
+#endif
+}
+
+bool glVersionAtLeast(int major, int minor)
+{
+    const char *version = (const char *)glGetString(GL_VERSION);
+    int maj = 0, min = 0;
+    if (!version || std::sscanf(version, "%d.%d", &maj, &min) != 2) return false;
+    return maj > major || (maj == major && min >= minor);
+}
+
+bool loadBufferApi()
+{
+    if (!glVersionAtLeast(1, 5)) return false;
+    gl.GenBuffers = (GenBuffersFn)getProc("glGenBuffers");
+    gl.DeleteBuffers = (DeleteBuffersFn)getProc("glDeleteBuffers");
+    gl.BindBuffer = (BindBufferFn)getProc("glBindBuffer");
+    gl.BufferData = (BufferDataFn)getProc("glBufferData");
+    gl.MapBuffer = (MapBufferFn)getProc("glMapBuffer");
+    gl.UnmapBuffer = (UnmapBufferFn)getProc("glUnmapBuffer");
+    if (glVersionAtLeast(3, 1))
+        gl.PrimitiveRestartIndex = (PrimitiveRestartIndexFn)getProc("glPrimitiveRestartIndex");
+    return gl.GenBuffers && gl.DeleteBuffers && gl.BindBuffer && gl.BufferData && gl.MapBuffer && gl.UnmapBuffer;
+}
+} // namespace
 
 void SilkSimulation::initialize()
 {
@@ -29,69 +220,322 @@ void SilkSimulation::initialize()
             p.pinned = (y == 0); // pin top row
         }
     }
+    m_lastStep = 0.0f;
 }
 
-void SilkSimulation::step(float dt)
+void SilkSimulation::setGravity(float gx, float gy)
 {
-    if (dt <= 0.0f) return;
-    const Vec2 gravity{ 0.0f, -1.5f };
-    const float damping = 0.9995f;
-    const float dt2 = dt * dt;
+    m_gravityX = gx;
+    m_gravityY = gy;
+}
 
-    // Verlet integrate
-    for (auto &p : m_particles) {
+void SilkSimulation::setDamping(float damping)
+{
+    m_damping = damping;
+}
+
+void SilkSimulation::setPinned(int x, int y, bool pinned)
+{
+    m_particles[idx(x, y, m_width)].pinned = pinned;
+}
+
+bool SilkSimulation::pinned(int x, int y) const
+{
+    return m_particles[idx(x, y, m_width)].pinned;
+}
+
+void SilkSimulation::getPoint(int x, int y, float &px, float &py, float &prevX, float &prevY) const
+{
+    const Particle &p = m_particles[idx(x, y, m_width)];
+    px = p.pos.x;
+    py = p.pos.y;
+    prevX = p.prev.x;
+    prevY = p.prev.y;
+}
+
+void SilkSimulation::setPoint(int x, int y, float px, float py, float prevX, float prevY)
+{
+    Particle &p = m_particles[idx(x, y, m_width)];
+    p.pos = { px, py };
+    p.prev = { prevX, prevY };
+}
+
+void SilkSimulation::integrateRows(int y0, int y1, float dt2)
+{
+    const Vec2 gravity{ m_gravityX, m_gravityY };
+    for (int i = idx(0, y0, m_width), n = idx(0, y1, m_width); i < n; ++i) {
+        Particle &p = m_particles[i];
         if (p.pinned) continue;
         Vec2 temp = p.pos;
-        Vec2 vel{ (p.pos.x - p.prev.x) * damping, (p.pos.y - p.prev.y) * damping };
+        Vec2 vel{ (p.pos.x - p.prev.x) * m_velocityScale, (p.pos.y - p.prev.y) * m_velocityScale };
         p.pos.x += vel.x + gravity.x * dt2;
         p.pos.y += vel.y + gravity.y * dt2;
         p.prev = temp;
     }
+}
+
+inline void SilkSimulation::solveLink(Particle &pa, Particle &pb, float target)
+{
+    float dx = pb.pos.x - pa.pos.x;
+    float dy = pb.pos.y - pa.pos.y;
+    float dist = std::sqrt(dx*dx + dy*dy);
+    if (dist <= 1e-6f) return;
+    float diff = (dist - target) / dist * 0.5f;
+    if (!pa.pinned) { pa.pos.x += dx * diff; pa.pos.y += dy * diff; }
+    if (!pb.pinned) { pb.pos.x -= dx * diff; pb.pos.y -= dy * diff; }
+}
+
+void SilkSimulation::solveHorizontal(int y)
+{
+    const float restX = 1.0f / (m_width - 1);
+    for (int x = 0; x < m_width - 1; ++x)
+        solveLink(m_particles[idx(x, y, m_width)], m_particles[idx(x + 1, y, m_width)], restX);
+}
+
+void SilkSimulation::solveVertical(int y)
+{
+    const float restY = 1.0f / (m_height - 1);
+    for (int x = 0; x < m_width; ++x)
+        solveLink(m_particles[idx(x, y, m_width)], m_particles[idx(x, y + 1, m_width)], restY);
+}
+
+void SilkSimulation::step(float dt)
+{
+    if (dt <= 0.0f) return;
+    const float dt2 = dt * dt;
+    // pos - prev is the velocity over the last step; rescale it when the
+    // step length changes (the factor is exactly the damping while it doesn't)
+    m_velocityScale = m_lastStep > 0.0f ? m_damping * (dt / m_lastStep) : m_damping;
+    m_lastStep = dt;
+
+    if (m_workers) {
+        m_workers->run(dt);
+        return;
+    }
+
+    // Verlet integrate
+    integrateRows(0, m_height, dt2);
 
     // constraints: structural (neighbors)
-    const int iterations = 6;
+    for (int it = 0; it < kIterations; ++it) {
+        for (int y = 0; y < m_height; ++y) solveHorizontal(y);
+        for (int y = 0; y < m_height - 1; ++y) solveVertical(y);
+    }
+}
+
+SilkSimulation::StepStats SilkSimulation::advance(float frameTime)
+{
+    StepStats stats;
+    float remaining = std::max(frameTime, 0.0f);
+    if (remaining > kMaxFrameTime) {
+        stats.droppedTime = remaining - kMaxFrameTime;
+        remaining = kMaxFrameTime;
+    }
+
+    // split what is left of the frame evenly into steps no longer than the
+    // chosen one, so every frame moves the cloth and no tail step is tiny
+    while (remaining > 1e-6f) {
+        if (stats.substeps == kMaxSubsteps) {
+            stats.droppedTime += remaining;
+            break;
+        }
+        const int count = std::max(1, (int)std::ceil(remaining / m_nextStep - 1e-3f));
+        const float dt = remaining / count;
+        step(dt);
+        remaining -= dt;
+        stats.shortestStep = stats.substeps ? std::min(stats.shortestStep, dt) : dt;
+        stats.longestStep = std::max(stats.longestStep, dt);
+        ++stats.substeps;
+
+        float strain, speed;
+        measureMotion(strain, speed);
+        stats.maxStrain = std::max(stats.maxStrain, strain);
+        stats.maxSpeed = std::max(stats.maxSpeed, speed);
+
+        // cut the step as soon as a limit is passed, but only grow it while
+        // both are well clear: a sheet whose step follows its stretch too
+        // closely gets pumped into swinging (a shorter step stiffens it)
+        const float travel = kMaxTravel / (m_width - 1);
+        float next = m_nextStep;
+        if (strain < 0.5f * kTargetStrain && speed * next < 0.5f * travel) next *= kGrowth;
+        if (strain > kTargetStrain) next = std::min(next, dt * kSafety * std::sqrt(kTargetStrain / strain));
+        if (speed * next > travel) next = kSafety * travel / speed;
+        if (!(strain == strain)) next = 0.0f; // blew up: as short as allowed
+        m_nextStep = std::min(std::max(next, kMinStep), kMaxStep);
+    }
+    return stats;
+}
+
+void SilkSimulation::measureMotion(float &maxStrain, float &maxSpeed) const
+{
     const float restX = 1.0f / (m_width - 1);
     const float restY = 1.0f / (m_height - 1);
+    float worst = 1.0f, fastest = 0.0f;
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            const Particle &p = m_particles[idx(x, y, m_width)];
+            if (x + 1 < m_width) {
+                const Particle &q = m_particles[idx(x + 1, y, m_width)];
+                float dx = q.pos.x - p.pos.x, dy = q.pos.y - p.pos.y;
+                float ratio = (dx*dx + dy*dy) / (restX * restX);
+                if (!(ratio <= worst)) worst = ratio;
+            }
+            if (y + 1 < m_height) {
+                const Particle &q = m_particles[idx(x, y + 1, m_width)];
+                float dx = q.pos.x - p.pos.x, dy = q.pos.y - p.pos.y;
+                float ratio = (dx*dx + dy*dy) / (restY * restY);
+                if (!(ratio <= worst)) worst = ratio;
+            }
+            float vx = p.pos.x - p.prev.x, vy = p.pos.y - p.prev.y;
+            fastest = std::max(fastest, vx*vx + vy*vy);
+        }
+    }
+    maxStrain = std::sqrt(worst) - 1.0f;
+    maxSpeed = m_lastStep > 0.0f ? std::sqrt(fastest) / m_lastStep : 0.0f;
+}
 
-    for (int it = 0; it < iterations; ++it) {
-        // horizontal constraints
+// One worker's share of a parallel step. Each worker owns a contiguous run
+// of strips; a strip relaxes its own rows, then the links below each strip
+// are relaxed in two phases, even strips first, so no two workers ever touch
+// the same row at once. The result depends on the strip height only, not on
+// the thread count.
+void SilkSimulation::stepStrips(int worker, float dt)
+{
+    const int count = m_workers->count;
+    const int strips = (m_height + m_stripHeight - 1) / m_stripHeight;
+    const int first = worker * strips / count;
+    const int last = (worker + 1) * strips / count;
+    const int rowBegin = std::min(first * m_stripHeight, m_height);
+    const int rowEnd = std::min(last * m_stripHeight, m_height);
+
+    integrateRows(rowBegin, rowEnd, dt * dt);
+    m_workers->barrier();
+
+    for (int it = 0; it < kIterations; ++it) {
+        for (int s = first; s < last; ++s) {
+            const int y0 = s * m_stripHeight;
+            const int y1 = std::min(y0 + m_stripHeight, m_height);
+            for (int y = y0; y < y1; ++y) solveHorizontal(y);
+            for (int y = y0; y < y1 - 1; ++y) solveVertical(y);
+        }
+        m_workers->barrier();
+        for (int parity = 0; parity < 2; ++parity) {
+            for (int s = first + ((first & 1) != parity); s < last && s < strips - 1; s += 2)
+                solveVertical((s + 1) * m_stripHeight - 1);
+            m_workers->barrier();
+        }
+    }
+}
+
+bool SilkSimulation::initBuffers()
+{
+    if (!loadBufferApi()) return false;
+    m_primitiveRestart = gl.PrimitiveRestartIndex != nullptr;
+
+    // grid edges: one line strip per row and per column, separated by the
+    // restart index; plain GL_LINES pairs when restart is unavailable
+    std::vector<GLuint> indices;
+    if (m_primitiveRestart) {
+        indices.reserve(m_height * (m_width + 1) + m_width * (m_height + 1));
         for (int y = 0; y < m_height; ++y) {
-            for (int x = 0; x < m_width - 1; ++x) {
-                int a = idx(x, y, m_width);
-                int b = idx(x + 1, y, m_width);
-                Particle &pa = m_particles[a];
-                Particle &pb = m_particles[b];
-                float dx = pb.pos.x - pa.pos.x;
-                float dy = pb.pos.y - pa.pos.y;
-                float dist = std::sqrt(dx*dx + dy*dy);
-                if (dist <= 1e-6f) continue;
-                float target = restX;
-                float diff = (dist - target) / dist * 0.5f;
-                if (!pa.pinned) { pa.pos.x += dx * diff; pa.pos.y += dy * diff; }
-                if (!pb.pinned) { pb.pos.x -= dx * diff; pb.pos.y -= dy * diff; }
-            }
+            for (int x = 0; x < m_width; ++x) indices.push_back(idx(x, y, m_width));
+            indices.push_back(kRestartIndex);
+        }
+        for (int x = 0; x < m_width; ++x) {
+            for (int y = 0; y < m_height; ++y) indices.push_back(idx(x, y, m_width));
+            indices.push_back(kRestartIndex);
         }
-        // vertical constraints
-        for (int y = 0; y < m_height - 1; ++y) {
+    } else {
+        indices.reserve(2 * (m_height * (m_width - 1) + m_width * (m_height - 1)));
+        for (int y = 0; y < m_height; ++y) {
             for (int x = 0; x < m_width; ++x) {
-                int a = idx(x, y, m_width);
-                int b = idx(x, y + 1, m_width);
-                Particle &pa = m_particles[a];
-                Particle &pb = m_particles[b];
-                float dx = pb.pos.x - pa.pos.x;
-                float dy = pb.pos.y - pa.pos.y;
-                float dist = std::sqrt(dx*dx + dy*dy);
-                if (dist <= 1e-6f) continue;
-                float target = restY;
-                float diff = (dist - target) / dist * 0.5f;
-                if (!pa.pinned) { pa.pos.x += dx * diff; pa.pos.y += dy * diff; }
-                if (!pb.pinned) { pb.pos.x -= dx * diff; pb.pos.y -= dy * diff; }
+                if (x < m_width - 1) { indices.push_back(idx(x, y, m_width)); indices.push_back(idx(x + 1, y, m_width)); }
+                if (y < m_height - 1) { indices.push_back(idx(x, y, m_width)); indices.push_back(idx(x, y + 1, m_width)); }
             }
         }
     }
+    m_indexCount = (int)indices.size();
+
+    gl.GenBuffers(1, &m_indexBuffer);
+    gl.BindBuffer(kElementArrayBuffer, m_indexBuffer);
+    gl.BufferData(kElementArrayBuffer, (std::ptrdiff_t)(indices.size() * sizeof(GLuint)), indices.data(), kStaticDraw);
+    gl.BindBuffer(kElementArrayBuffer, 0);
+
+    gl.GenBuffers(1, &m_positionBuffer);
+    return true;
+}
+
+bool SilkSimulation::uploadPositions()
+{
+    const std::ptrdiff_t size = (std::ptrdiff_t)(m_particles.size() * 2 * sizeof(float));
+    gl.BindBuffer(kArrayBuffer, m_positionBuffer);
+    // orphan the previous frame's storage so the map doesn't stall on the GPU
+    gl.BufferData(kArrayBuffer, size, nullptr, kStreamDraw);
+    float *dst = (float *)gl.MapBuffer(kArrayBuffer, kWriteOnly);
+    if (!dst) {
+        gl.BindBuffer(kArrayBuffer, 0);
+        return false;
+    }
+    for (const auto &p : m_particles) {
+        *dst++ = p.pos.x;
+        *dst++ = p.pos.y;
+    }
+    const bool intact = gl.UnmapBuffer(kArrayBuffer) == GL_TRUE;
+    if (!intact) gl.BindBuffer(kArrayBuffer, 0);
+    return intact;
 }
 
 void SilkSimulation::render()
+{
+    if (m_bufferState == BufferState::Untried)
+        m_bufferState = initBuffers() ? BufferState::Ready : BufferState::Unsupported;
+    if (m_bufferState != BufferState::Ready) {
+        renderImmediate();
+        return;
+    }
+
+    // the orphaned buffer holds nothing drawable if the upload failed; draw
+    // this frame the slow way and try the buffer again next frame
+    if (!uploadPositions()) {
+        renderImmediate();
+        return;
+    }
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, nullptr);
+
+    // draw structural lines
+    glColor3f(0.9f, 0.9f, 0.8f);
+    gl.BindBuffer(kElementArrayBuffer, m_indexBuffer);
+    if (m_primitiveRestart) {
+        glEnable(kPrimitiveRestart);
+        gl.PrimitiveRestartIndex(kRestartIndex);
+        glDrawElements(GL_LINE_STRIP, m_indexCount, GL_UNSIGNED_INT, nullptr);
+        glDisable(kPrimitiveRestart);
+    } else {
+        glDrawElements(GL_LINES, m_indexCount, GL_UNSIGNED_INT, nullptr);
+    }
+    gl.BindBuffer(kElementArrayBuffer, 0);
+
+    // draw particles from the same position buffer
+    glPointSize(3.0f);
+    glColor3f(1.0f, 0.3f, 0.3f);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)m_particles.size());
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl.BindBuffer(kArrayBuffer, 0);
+}
+
+void SilkSimulation::shutdown()
+{
+    if (m_bufferState == BufferState::Ready) {
+        gl.DeleteBuffers(1, &m_positionBuffer);
+        gl.DeleteBuffers(1, &m_indexBuffer);
+        m_positionBuffer = m_indexBuffer = 0;
+    }
+    m_bufferState = BufferState::Untried;
+}
+
+void SilkSimulation::renderImmediate()
 {
     // draw structural lines
     glColor3f(0.9f, 0.9f, 0.8f);
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <vector>
 
 class SilkSimulation {
@@ -8,7 +9,48 @@ public:
 
     void initialize();
     void step(float dt);
+
+    // what advance() chose for one frame
+    struct StepStats {
+        int substeps = 0;
+        float shortestStep = 0.0f, longestStep = 0.0f;
+        float maxStrain = 0.0f;   // worst link stretch, (length - rest) / rest
+        float maxSpeed = 0.0f;    // fastest particle, units per second
+        float droppedTime = 0.0f; // frame time over the clamp or the budget
+    };
+    // Steps one frame of frameTime in adaptive substeps: after each, the
+    // worst link stretch and particle speed pick the next one's length
+    // (shorter when either is too high, slowly longer while calm), and the
+    // rest of the frame is split evenly into steps no longer than that. At
+    // most a fixed budget of substeps per frame; time past it is dropped.
+    StepStats advance(float frameTime);
+    // Split step() into horizontal strips of stripHeight rows (0: one strip
+    // per thread) worked by persistent threads. Horizontal links stay inside
+    // a strip; vertical links across strip boundaries run in an even and an
+    // odd phase. threads <= 1 restores the serial solver, and grids too
+    // small to pay for the barriers start no threads at all.
+    void setThreading(int threads, int stripHeight = 0);
+
+    // Per-instance physics; the defaults are the gravity (0, -1.5) and
+    // damping step() always used. Pins are set by initialize() (the top
+    // row) and changed after it.
+    void setGravity(float gx, float gy);
+    void setDamping(float damping);
+    void setPinned(int x, int y, bool pinned);
+    float gravityX() const { return m_gravityX; }
+    float gravityY() const { return m_gravityY; }
+    float damping() const { return m_damping; }
+    bool pinned(int x, int y) const;
+
+    // grid point state after initialize(), e.g. to load a SilkEnsemble lane
+    // or read one back
+    void getPoint(int x, int y, float &px, float &py, float &prevX, float &prevY) const;
+    void setPoint(int x, int y, float px, float py, float prevX, float prevY);
+    int width() const { return m_width; }
+    int height() const { return m_height; }
     void render();
+    // release GL buffers; call while the context is still current
+    void shutdown();
 
 private:
     struct Vec2 { float x, y; Vec2() : x(0), y(0) {} Vec2(float a, float b):x(a),y(b){} };
@@ -18,7 +60,43 @@ private:
         bool pinned = false;
     };
 
+    struct StripWorkers;
+
+    static void solveLink(Particle &pa, Particle &pb, float target);
+    void integrateRows(int y0, int y1, float dt2);
+    void solveHorizontal(int y);
+    // links between row y and row y + 1
+    void solveVertical(int y);
+    void stepStrips(int worker, float dt);
+    void measureMotion(float &maxStrain, float &maxSpeed) const;
+
+    bool initBuffers();
+    // false when the map failed or the data store was lost on unmap, which
+    // leaves the buffer undefined for this frame
+    bool uploadPositions();
+    void renderImmediate();
+
     int m_width;
     int m_height;
     std::vector<Particle> m_particles;
+
+    float m_gravityX = 0.0f;
+    float m_gravityY;
+    float m_damping;
+
+    std::unique_ptr<StripWorkers> m_workers;
+    int m_stripHeight = 0;
+
+    // step length bookkeeping for step() and advance()
+    float m_lastStep = 0.0f;
+    float m_velocityScale = 1.0f;
+    float m_nextStep = 1.0f / 60.0f;
+
+    // buffered render path: static grid indices + streamed positions
+    enum class BufferState { Untried, Ready, Unsupported };
+    BufferState m_bufferState = BufferState::Untried;
+    unsigned int m_positionBuffer = 0;
+    unsigned int m_indexBuffer = 0;
+    int m_indexCount = 0;
+    bool m_primitiveRestart = false;
 };
@@ -2,6 +2,8 @@
 #include <gl/GL.h>
 #include "SilkSimulation.h"
 #include <chrono>
+#include <cstdio>
+#include <thread>
 
 static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
@@ -58,8 +60,11 @@ int main()
 
     SilkSimulation sim;
     sim.initialize();
+    // no threads start unless the grid is large enough to pay for the barriers
+    sim.setThreading((int)std::thread::hardware_concurrency());
 
     auto last = std::chrono::high_resolution_clock::now();
+    auto lastTitle = last;
     bool running = true;
     while (running) {
         // process messages
@@ -75,8 +80,7 @@ int main()
         auto now = std::chrono::high_resolution_clock::now();
         std::chrono::duration<float> elapsed = now - last;
         last = now;
-        float dt = elapsed.count();
-        if (dt > 0.033f) dt = 0.033f; // clamp
+        float dt = elapsed.count(); // advance() clamps long frames
 
         // viewport
         RECT r; GetClientRect(hwnd, &r);
@@ -98,14 +102,25 @@ int main()
         glClearColor(0.12f, 0.12f, 0.14f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        sim.step(dt);
+        SilkSimulation::StepStats stats = sim.advance(dt);
         sim.render();
 
+        // the substeps advance() chose, twice a second
+        if (now - lastTitle > std::chrono::milliseconds(500)) {
+            lastTitle = now;
+            char title[128];
+            snprintf(title, sizeof(title), "Silk Simulation - %d steps, %.1f-%.1f ms, strain %.3f",
+                     stats.substeps, stats.shortestStep * 1000.0f, stats.longestStep * 1000.0f,
+                     stats.maxStrain);
+            SetWindowTextA(hwnd, title);
+        }
+
         SwapBuffers(hdc);
         // small sleep to avoid 100% CPU
         Sleep(1);
     }
 
+    sim.shutdown();
     wglMakeCurrent(nullptr, nullptr);
     wglDeleteContext(glrc);
     ReleaseDC(hwnd, hdc);